@@ -0,0 +1,127 @@
+//-----------------------------------------------------------------------------
+// File: ButtonBindings.cpp
+//
+// Button chords and timing rules
+//-----------------------------------------------------------------------------
+#include "ButtonBindings.h"
+
+
+//-----------------------------------------------------------------------------
+ButtonBindings::ButtonBindings() :
+    myRuleCount( 0 ),
+    myWatchMask( 0 )
+{
+    for( int i = 0; i < BUTTON_MAX_ACTIONS; i++ )
+        myActions[i] = nullptr;
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        myButtons[i] = 0;
+        myArmed[i] = 0;
+        for( int j = 0; j < BUTTON_MAX_RULES; j++ )
+        {
+            myDueUs[i][j] = 0;
+            myTapUs[i][j] = 0;
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+bool ButtonBindings::addRules( const BUTTON_RULE *rules, int count )
+{
+    if( myRuleCount + count > BUTTON_MAX_RULES )
+        return false;
+    for( int i = 0; i < count; i++ )
+    {
+        myRules[myRuleCount] = &rules[i];
+        myWatchMask |= rules[i].wChord;
+        myRuleCount++;
+    }
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+void ButtonBindings::setAction( int action, ArFunctor1<int> *functor )
+{
+    if( action >= 0 && action < BUTTON_MAX_ACTIONS )
+        myActions[action] = functor;
+}
+
+
+//-----------------------------------------------------------------------------
+void ButtonBindings::fire( int rule, int slot )
+{
+    ArFunctor1<int> *functor = myActions[myRules[rule]->uAction];
+    if( functor != nullptr )
+        functor->invoke( slot );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: update()
+// Desc: Nothing to do unless a watched button changed or a timed rule is
+//       armed.  Otherwise each rule is one test of its chord against the
+//       previous and current buttons:
+//         completed = chord in now, not before
+//         broken    = chord in before, not now
+//-----------------------------------------------------------------------------
+void ButtonBindings::update( int slot, unsigned short wButtons, long long llNowUs )
+{
+    unsigned short wPrevious = myButtons[slot];
+    myButtons[slot] = wButtons;
+    if( ( ( wPrevious ^ wButtons ) & myWatchMask ) == 0 && myArmed[slot] == 0 )
+        return;
+
+    for( int i = 0; i < myRuleCount; i++ )
+    {
+        const BUTTON_RULE &rule = *myRules[i];
+        unsigned short wChord = rule.wChord;
+        bool bWas = ( wPrevious & wChord ) == wChord;
+        bool bIs = ( wButtons & wChord ) == wChord;
+        unsigned int bit = 1u << i;
+        long long llTimeUs = (long long)rule.wTimeMs * 1000;
+
+        if( bIs && !bWas )
+        {
+            switch( rule.eEvent )
+            {
+                case BUTTON_PRESS:
+                    fire( i, slot );
+                    break;
+                case BUTTON_REPEAT:
+                    fire( i, slot );
+                    // fall through
+                case BUTTON_HOLD:
+                    myDueUs[slot][i] = llNowUs + llTimeUs;
+                    myArmed[slot] |= bit;
+                    break;
+                case BUTTON_DOUBLE_TAP:
+                    if( myTapUs[slot][i] != 0 && llNowUs - myTapUs[slot][i] <= llTimeUs )
+                    {
+                        myTapUs[slot][i] = 0;
+                        fire( i, slot );
+                    }
+                    else
+                        myTapUs[slot][i] = llNowUs;
+                    break;
+                default:
+                    break;
+            }
+        }
+        else if( bWas && !bIs )
+        {
+            myArmed[slot] &= ~bit;
+            if( rule.eEvent == BUTTON_RELEASE )
+                fire( i, slot );
+        }
+        else if( bIs && ( myArmed[slot] & bit ) && llNowUs >= myDueUs[slot][i] )
+        {
+            fire( i, slot );
+            if( rule.eEvent == BUTTON_REPEAT )
+                myDueUs[slot][i] += llTimeUs;
+            else
+                myArmed[slot] &= ~bit;
+        }
+    }
+}
@@ -0,0 +1,62 @@
+//-----------------------------------------------------------------------------
+// File: ButtonBindings.h
+//
+// Button chords, holds, repeats and double taps bound to ArFunctors.  Rules
+// come from static const tables; adding them only fills fixed arrays, and
+// evaluating a pad is a few bit operations on its previous and current
+// buttons, so nothing is allocated or branched per button while driving.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "Gamepad.h"
+#include "Aria.h"
+
+#define BUTTON_MAX_RULES   16
+#define BUTTON_MAX_ACTIONS 16
+
+enum BUTTON_EVENT
+{
+    BUTTON_PRESS,        // the chord becomes fully held
+    BUTTON_RELEASE,      // a fully held chord is broken
+    BUTTON_HOLD,         // held for wTimeMs, once per hold
+    BUTTON_REPEAT,       // on press, then every wTimeMs while held
+    BUTTON_DOUBLE_TAP    // pressed twice within wTimeMs
+};
+
+struct BUTTON_RULE
+{
+    unsigned short wChord;      // GAMEPAD_BUTTON bits that must all be down
+    BUTTON_EVENT   eEvent;
+    unsigned short wTimeMs;     // BUTTON_HOLD, BUTTON_REPEAT (not 0) and BUTTON_DOUBLE_TAP
+    unsigned char  uAction;     // index given to setAction()
+};
+
+class ButtonBindings
+{
+public:
+    ButtonBindings();
+
+    // rules must stay valid (a static table); returns false when there is
+    // no room for them.  Configure before update() is first called.
+    bool addRules( const BUTTON_RULE *rules, int count );
+    // functor is called with the pad slot when a rule for action fires
+    void setAction( int action, ArFunctor1<int> *functor );
+
+    // Feed pad slot's buttons (0 when disconnected) at llNowUs and fire
+    // whatever rules that completes
+    void update( int slot, unsigned short wButtons, long long llNowUs );
+
+protected:
+    void fire( int rule, int slot );
+
+    const BUTTON_RULE *myRules[BUTTON_MAX_RULES];
+    int myRuleCount;
+    unsigned short myWatchMask;         // every button some rule uses
+    ArFunctor1<int> *myActions[BUTTON_MAX_ACTIONS];
+
+    // Per pad
+    unsigned short myButtons[MAX_CONTROLLERS];
+    unsigned int myArmed[MAX_CONTROLLERS];                  // timed rules waiting on myDueUs
+    long long myDueUs[MAX_CONTROLLERS][BUTTON_MAX_RULES];
+    long long myTapUs[MAX_CONTROLLERS][BUTTON_MAX_RULES];   // last single tap, 0 for none
+};
@@ -0,0 +1,226 @@
+//-----------------------------------------------------------------------------
+// File: CoalescingConnection.cpp
+//
+// One write per robot cycle for the outgoing commands
+//
+// A robot packet is 0xFA 0xFB, a length byte counting the rest, the command
+// byte, the arguments and a two byte checksum.  ArRobotPacketSender writes
+// each packet with one write() call.
+//-----------------------------------------------------------------------------
+#include "CoalescingConnection.h"
+#include <string.h>
+
+#define PACKET_HEADER_1   0xFA
+#define PACKET_HEADER_2   0xFB
+#define PACKET_MIN_BYTES  6     // header, length, command, checksum
+
+
+//-----------------------------------------------------------------------------
+CoalescingConnection::CoalescingConnection( ArRobot *robot ) :
+    myRobot( robot ),
+    myConn( robot->getDeviceConnection() ),
+    myUsed( 0 ),
+    myCount( 0 ),
+    myPackets( 0 ),
+    myDropped( 0 ),
+    myWrites( 0 ),
+    myFlushCB( this, &CoalescingConnection::flush )
+{
+    myMutex.setLogName( "CoalescingConnection::myMutex" );
+    setPortName( myConn->getPortName() );
+    setPortType( myConn->getPortType() );
+    setDeviceName( myConn->getDeviceName() );
+
+    // The last user task, so every command of the cycle is in
+    myRobot->lock();
+    myRobot->setDeviceConnection( this );
+    myRobot->addUserTask( "CoalescingConnection flush", 1, &myFlushCB );
+    myRobot->unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+CoalescingConnection::~CoalescingConnection()
+{
+    detach();
+}
+
+
+//-----------------------------------------------------------------------------
+void CoalescingConnection::detach()
+{
+    if( myConn == nullptr )
+        return;
+    myRobot->lock();
+    myRobot->remUserTask( &myFlushCB );
+    flush();
+    myRobot->setDeviceConnection( myConn );
+    myRobot->unlock();
+    myConn = nullptr;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: isSetting()
+// Desc: Commands whose last value is all that counts.  SETA and SETRA are
+//       not among them: the sign picks acceleration or deceleration.
+//-----------------------------------------------------------------------------
+bool CoalescingConnection::isSetting( unsigned char command )
+{
+    switch( command )
+    {
+        case ArCommands::PULSE:
+        case ArCommands::SETV:
+        case ArCommands::ROTATE:
+        case ArCommands::SETRV:
+        case ArCommands::VEL:
+        case ArCommands::HEAD:
+        case ArCommands::RVEL:
+        case ArCommands::VEL2:
+        case ArCommands::LATVEL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+int CoalescingConnection::write( const char *data, unsigned int size )
+{
+    if( size > COALESCE_BUFFER_BYTES )
+        return myConn->write( data, size );
+
+    const unsigned char *bytes = (const unsigned char *)data;
+    int command = -1;
+    if( size >= PACKET_MIN_BYTES && bytes[0] == PACKET_HEADER_1 && bytes[1] == PACKET_HEADER_2 &&
+        bytes[2] + 3u == size )
+        command = bytes[3];
+
+    myMutex.lock();
+    myPackets++;
+
+    // Drop an earlier packet this one supersedes and close the gap
+    if( command >= 0 && isSetting( (unsigned char)command ) )
+    {
+        for( int i = 0; i < myCount; i++ )
+        {
+            if( myCommands[i] != command )
+                continue;
+            unsigned int start = myOffsets[i];
+            unsigned int end = i + 1 < myCount ? myOffsets[i + 1] : myUsed;
+            memmove( myBuffer + start, myBuffer + end, myUsed - end );
+            myUsed -= end - start;
+            for( int j = i + 1; j < myCount; j++ )
+            {
+                myOffsets[j - 1] = myOffsets[j] - ( end - start );
+                myCommands[j - 1] = myCommands[j];
+            }
+            myCount--;
+            myDropped++;
+            break;
+        }
+    }
+
+    if( myUsed + size > COALESCE_BUFFER_BYTES || myCount == COALESCE_MAX_PACKETS )
+        flushLocked();
+    myOffsets[myCount] = myUsed;
+    myCommands[myCount] = command;
+    myCount++;
+    memcpy( myBuffer + myUsed, data, size );
+    myUsed += size;
+    myMutex.unlock();
+    return (int)size;
+}
+
+
+//-----------------------------------------------------------------------------
+void CoalescingConnection::flush()
+{
+    myMutex.lock();
+    flushLocked();
+    myMutex.unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+void CoalescingConnection::addWriteCB( ArFunctor *functor )
+{
+    myMutex.lock();
+    myWriteCBs.push_back( functor );
+    myMutex.unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+void CoalescingConnection::remWriteCB( ArFunctor *functor )
+{
+    myMutex.lock();
+    myWriteCBs.remove( functor );
+    myMutex.unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+void CoalescingConnection::flushLocked()
+{
+    if( myUsed == 0 )
+        return;
+    if( myConn->write( myBuffer, myUsed ) < 0 )
+        ArLog::log( ArLog::Terse, "CoalescingConnection: could not write %u bytes of commands", myUsed );
+    myWrites++;
+    myUsed = 0;
+    myCount = 0;
+    for( std::list<ArFunctor *>::iterator it = myWriteCBs.begin(); it != myWriteCBs.end(); ++it )
+        ( *it )->invoke();
+}
+
+
+//-----------------------------------------------------------------------------
+int CoalescingConnection::read( const char *data, unsigned int size, unsigned int msWait )
+{
+    return myConn->read( data, size, msWait );
+}
+
+
+//-----------------------------------------------------------------------------
+int CoalescingConnection::getStatus()
+{
+    return myConn->getStatus();
+}
+
+
+//-----------------------------------------------------------------------------
+bool CoalescingConnection::openSimple()
+{
+    return myConn->openSimple();
+}
+
+
+//-----------------------------------------------------------------------------
+bool CoalescingConnection::close()
+{
+    flush();
+    return myConn->close();
+}
+
+
+//-----------------------------------------------------------------------------
+const char *CoalescingConnection::getOpenMessage( int messageNumber )
+{
+    return myConn->getOpenMessage( messageNumber );
+}
+
+
+//-----------------------------------------------------------------------------
+ArTime CoalescingConnection::getTimeRead( int index )
+{
+    return myConn->getTimeRead( index );
+}
+
+
+//-----------------------------------------------------------------------------
+bool CoalescingConnection::isTimeStamping()
+{
+    return myConn->isTimeStamping();
+}
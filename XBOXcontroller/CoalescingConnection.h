@@ -0,0 +1,78 @@
+//-----------------------------------------------------------------------------
+// File: CoalescingConnection.h
+//
+// Sits between ArRobot and its real device connection and holds back the
+// command packets written during a robot cycle, then writes them all at the
+// end of the cycle with a single write.  A command that only sets a value
+// (velocity, heading, limits) replaces an earlier one with the same ID still
+// waiting in the queue, so the robot gets one VEL per cycle however many
+// times it was set.  Everything else goes out in the order it was written.
+//
+// Reads and the rest pass straight through.  A packet written between cycles
+// waits for the end of the next one.  ArRobotPacketSender's sent callback
+// therefore fires when a packet is queued; a write callback tells when it
+// actually went out.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "Aria.h"
+#include <list>
+
+#define COALESCE_BUFFER_BYTES 1024  // a cycle's worth of commands; a full queue is flushed early
+#define COALESCE_MAX_PACKETS    32
+
+class CoalescingConnection : public ArDeviceConnection
+{
+public:
+    // robot must already be connected through its device connection; the
+    // connection is swapped for this one until detach()
+    CoalescingConnection( ArRobot *robot );
+    virtual ~CoalescingConnection();
+
+    // Put the original connection back, after a last flush
+    void detach();
+
+    // Write what is queued.  Called at the end of every robot cycle.
+    void flush();
+
+    // Called after every write to the real connection, with our mutex held
+    void addWriteCB( ArFunctor *functor );
+    void remWriteCB( ArFunctor *functor );
+
+    virtual int read( const char *data, unsigned int size, unsigned int msWait = 0 );
+    virtual int write( const char *data, unsigned int size );
+    virtual int getStatus();
+    virtual bool openSimple();
+    virtual bool close();
+    virtual const char *getOpenMessage( int messageNumber );
+    virtual ArTime getTimeRead( int index );
+    virtual bool isTimeStamping();
+
+    // Packets written to us, dropped as superseded, and writes made below
+    unsigned int getPackets() const { return myPackets; }
+    unsigned int getDropped() const { return myDropped; }
+    unsigned int getWrites() const { return myWrites; }
+
+protected:
+    static bool isSetting( unsigned char command );
+    void flushLocked();
+
+    ArRobot *myRobot;
+    ArDeviceConnection *myConn;
+
+    ArMutex myMutex;
+    char myBuffer[COALESCE_BUFFER_BYTES];
+    unsigned int myUsed;
+    // Where each queued packet starts, and its command byte (-1 when the
+    // data was not a whole robot packet)
+    unsigned int myOffsets[COALESCE_MAX_PACKETS];
+    int myCommands[COALESCE_MAX_PACKETS];
+    int myCount;
+
+    unsigned int myPackets;
+    unsigned int myDropped;
+    unsigned int myWrites;
+    std::list<ArFunctor *> myWriteCBs;
+
+    ArFunctorC<CoalescingConnection> myFlushCB;
+};
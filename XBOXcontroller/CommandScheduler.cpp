@@ -0,0 +1,384 @@
+//-----------------------------------------------------------------------------
+// File: CommandScheduler.cpp
+//
+// Applies the operator's motion target to ArRobot once per robot cycle
+//-----------------------------------------------------------------------------
+#include "CommandScheduler.h"
+#include "HighResClock.h"
+#include <math.h>
+#include <stdio.h>
+
+static const char *LATENCY_STAGE_NAMES[LATENCY_STAGES] =
+{
+    "input->submit", "submit->cycle", "cycle->send", "input->send"
+};
+
+
+//-----------------------------------------------------------------------------
+CommandScheduler::CommandScheduler( ArRobot *robot, int holdMs ) :
+    myRobot( robot ),
+    myHoldMs( holdMs ),
+    myDeadlineUs( 0 ),
+    myVersion( 0 ),
+    mySubmitUs( 0 ),
+    myInputIntervalMs( 0 ),
+    myHaveTarget( false ),
+    myTakenVersion( 0 ),
+    mySupersededCount( 0 ),
+    myStopped( true ),
+    myExpiredCount( 0 ),
+    myHeadingSent( false ),
+    myHeadingReached( false ),
+    mySentHeading( 0 ),
+    myHeadingCommands( 0 ),
+    myHeadingsReached( 0 ),
+    myAdaptCycle( true ),
+    myPacketIntervalMs( 0 ),
+    myCycleChanges( 0 ),
+    myAppliedUs( 0 ),
+    myAppliedInputUs( 0 ),
+    myConn( nullptr ),
+    myQueuedUs( 0 ),
+    myQueuedInputUs( 0 ),
+    myFirstSendUs( 0 ),
+    myTaskCB( this, &CommandScheduler::task ),
+    myPacketSentCB( this, &CommandScheduler::packetSent ),
+    myPacketsWrittenCB( this, &CommandScheduler::packetsWritten )
+{
+    // The robot may already be running its task loop
+    myRobot->lock();
+    // Low among the sensor tasks so the SIP and sensors are interpreted
+    // first, but still ahead of the actions and the state reflector
+    myRobot->addSensorInterpTask( "CommandScheduler", 10, &myTaskCB );
+    myRobot->getPacketSender()->setPacketSentCallback( &myPacketSentCB );
+    myRobot->unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+CommandScheduler::~CommandScheduler()
+{
+    sendThrough( nullptr );
+    myRobot->lock();
+    myRobot->remSensorInterpTask( &myTaskCB );
+    myRobot->getPacketSender()->setPacketSentCallback( nullptr );
+    myRobot->unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+void CommandScheduler::submit( const MOTION_TARGET &target )
+{
+    MOTION_TARGET resolved = target;
+    resolved.resolve();
+
+    long long llNowUs = MonotonicMicros();
+    if( resolved.llInputUs != 0 )
+        myLatency[LATENCY_INPUT_TO_SUBMIT].add( llNowUs - resolved.llInputUs );
+
+    if( mySubmitUs != 0 )
+    {
+        double interval = ( llNowUs - mySubmitUs ) / 1000.0;
+        myInputIntervalMs = myInputIntervalMs == 0 ? interval : myInputIntervalMs * 0.9 + interval * 0.1;
+    }
+    mySubmitUs = llNowUs;
+
+    myDeadlineUs.store( llNowUs + myHoldMs * 1000LL );
+    MOTION_MAIL *mail = myMailbox.beginWrite();
+    mail->target = resolved;
+    mail->uVersion = ++myVersion;
+    mail->llSubmitUs = llNowUs;
+    myMailbox.publish();
+}
+
+
+//-----------------------------------------------------------------------------
+void CommandScheduler::keepAlive()
+{
+    myDeadlineUs.store( MonotonicMicros() + myHoldMs * 1000LL );
+}
+
+
+//-----------------------------------------------------------------------------
+void CommandScheduler::logLatency( const char *prefix )
+{
+    char name[128];
+    for( int i = 0; i < LATENCY_STAGES; i++ )
+    {
+        sprintf( name, "%.100s %s", prefix, LATENCY_STAGE_NAMES[i] );
+        myLatency[i].log( name );
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: adaptCycle()
+// Desc: Track the SIP interval from getLastPacketTime() and, every
+//       CYCLE_ADAPT_MS, make it the robot's cycle time.  A chained cycle
+//       waits for the next SIP no longer than the cycle time, and an
+//       unchained one runs at it, so either way the cycle tracks the packets
+//       and a command set in this task goes out with the next send.
+//-----------------------------------------------------------------------------
+void CommandScheduler::adaptCycle()
+{
+    ArTime packetTime = myRobot->getLastPacketTime();
+    long interval = packetTime.mSecSince( myLastPacketTime );
+    myLastPacketTime = packetTime;
+    if( interval <= 0 || interval > 1000 )
+        return;
+    myPacketIntervalMs = myPacketIntervalMs == 0 ? interval : myPacketIntervalMs * 0.9 + interval * 0.1;
+
+    if( !myAdaptCycle.load() || myLastAdapt.mSecSince() < CYCLE_ADAPT_MS )
+        return;
+    myLastAdapt.setToNow();
+
+    unsigned int cycle = (unsigned int)( myPacketIntervalMs + 0.5 );
+    if( cycle < CYCLE_MIN_MS ) cycle = CYCLE_MIN_MS;
+    if( cycle > CYCLE_MAX_MS ) cycle = CYCLE_MAX_MS;
+    unsigned int current = myRobot->getCycleTime();
+    if( cycle + 5 <= current || cycle >= current + 5 )
+    {
+        myRobot->setCycleTime( cycle );
+        myCycleChanges++;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: sendThrough()
+// Desc: Called from the thread that owns conn, robot cycle running or not
+//-----------------------------------------------------------------------------
+void CommandScheduler::sendThrough( CoalescingConnection *conn )
+{
+    myRobot->lock();
+    if( myConn != nullptr )
+        myConn->remWriteCB( &myPacketsWrittenCB );
+    myConn = conn;
+    if( myConn != nullptr )
+        myConn->addWriteCB( &myPacketsWrittenCB );
+    myQueuedUs.store( 0 );
+    myRobot->unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: packetSent()
+// Desc: ArRobotPacketSender callback, after every packet it writes.  The
+//       first motion command after a changed target was applied closes the
+//       last two stages, or, when the connection only queues it, hands them
+//       to packetsWritten().  ArRobot only sends what changed, so a target
+//       that asks for the same motion as before is not timed at all.
+//-----------------------------------------------------------------------------
+void CommandScheduler::packetSent( ArRobotPacket *packet )
+{
+    switch( packet->getID() )
+    {
+        case ArCommands::VEL:
+        case ArCommands::RVEL:
+        case ArCommands::VEL2:
+        case ArCommands::HEAD:
+        case ArCommands::DHEAD:
+            break;
+        default:
+            return;
+    }
+
+    long long llAppliedUs = myAppliedUs.exchange( 0 );
+    if( llAppliedUs == 0 )
+        return;
+    if( myConn != nullptr )
+    {
+        myQueuedInputUs.store( myAppliedInputUs.load() );
+        myQueuedUs.store( llAppliedUs );
+        return;
+    }
+    closeSend( llAppliedUs, myAppliedInputUs.load() );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: packetsWritten()
+// Desc: CoalescingConnection callback, after the queued commands went out
+//-----------------------------------------------------------------------------
+void CommandScheduler::packetsWritten()
+{
+    long long llAppliedUs = myQueuedUs.exchange( 0 );
+    if( llAppliedUs == 0 )
+        return;
+    closeSend( llAppliedUs, myQueuedInputUs.load() );
+}
+
+
+//-----------------------------------------------------------------------------
+void CommandScheduler::closeSend( long long llAppliedUs, long long llInputUs )
+{
+    long long llNowUs = MonotonicMicros();
+    long long llNone = 0;
+    myFirstSendUs.compare_exchange_strong( llNone, llNowUs );
+    myLatency[LATENCY_CYCLE_TO_SEND].add( llNowUs - llAppliedUs );
+    if( llInputUs != 0 )
+        myLatency[LATENCY_INPUT_TO_SEND].add( llNowUs - llInputUs );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: turning()
+// Desc: True while a setHeading is still being carried out
+//-----------------------------------------------------------------------------
+bool CommandScheduler::turning()
+{
+    if( !myHeadingSent || myHeadingReached )
+        return false;
+    if( !myRobot->isHeadingDone() )
+        return true;
+    myHeadingReached = true;
+    myHeadingsReached++;
+    return false;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: applyHeading()
+// Desc: Absolute heading servo.  ArRobot keeps turning to the last heading
+//       on its own, so it is only told again when the target has moved by
+//       more than HEADING_RESEND_DEG; stick jitter costs nothing.
+//-----------------------------------------------------------------------------
+void CommandScheduler::applyHeading( double heading )
+{
+    if( !myHeadingSent || fabs( ArMath::subAngle( heading, mySentHeading ) ) > HEADING_RESEND_DEG )
+    {
+        myRobot->setHeading( heading );
+        mySentHeading = heading;
+        myHeadingSent = true;
+        myHeadingReached = false;
+        myHeadingCommands++;
+    }
+    turning();
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: stop()
+// Desc: Stop once.  With bLetTurnFinish a heading the robot is still turning
+//       to is completed first, so letting go of the stick does not leave the
+//       robot pointing somewhere in between.
+//-----------------------------------------------------------------------------
+void CommandScheduler::stop( bool bLetTurnFinish )
+{
+    if( myStopped )
+        return;
+    if( bLetTurnFinish && turning() )
+    {
+        myRobot->setVel( 0 );
+        return;
+    }
+    myRobot->setVel( 0 );
+    myRobot->setRotVel( 0 );
+    myHeadingSent = false;
+    myStopped = true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: task()
+// Desc: ArRobot sync task, so the robot is already locked and the whole
+//       target goes out as one batch.  Re-sends the current target every
+//       cycle while it is active, stops once when it goes idle or expires,
+//       and otherwise leaves the robot alone so other clients (key handler,
+//       actions) can drive it.
+//-----------------------------------------------------------------------------
+void CommandScheduler::task()
+{
+    adaptCycle();
+
+    // The mail is taken before the deadline is read; see myDeadlineUs
+    const MOTION_MAIL *mail = myMailbox.consume();
+    bool bNewTarget = mail != nullptr;
+    bool bDeltaPending = false;
+    long long llSubmitUs = 0;
+    if( bNewTarget )
+    {
+        if( mail->uVersion > myTakenVersion + 1 )
+            mySupersededCount += mail->uVersion - myTakenVersion - 1;
+        myTakenVersion = mail->uVersion;
+        myTarget = mail->target;
+        llSubmitUs = mail->llSubmitUs;
+        bDeltaPending = ( myTarget.eRot == MOTION_TARGET::ROT_DELTA_HEADING );
+        myHaveTarget = true;
+    }
+    const MOTION_TARGET &target = myTarget;
+    bool bHaveTarget = myHaveTarget;
+    long long llNowUs = MonotonicMicros();
+    bool bExpired = bHaveTarget && llNowUs >= myDeadlineUs.load();
+    if( bExpired )
+        myHaveTarget = false;
+
+    if( bNewTarget )
+    {
+        myLatency[LATENCY_SUBMIT_TO_CYCLE].add( llNowUs - llSubmitUs );
+        if( !bExpired && !target.sameMotion( myAppliedTarget ) )
+        {
+            myAppliedInputUs.store( target.llInputUs );
+            myAppliedUs.store( llNowUs );
+        }
+        myAppliedTarget = target;
+    }
+    if( bExpired )
+        myAppliedTarget = MOTION_TARGET();
+
+    if( bExpired )
+    {
+        if( !myStopped )
+            myExpiredCount++;
+        stop( false );
+        return;
+    }
+
+    if( !bHaveTarget || target.isIdle() )
+    {
+        stop( true );
+        return;
+    }
+
+    switch( target.eTrans )
+    {
+        case MOTION_TARGET::TRANS_VEL2:
+            myRobot->setVel2( target.dLeftVel, target.dRightVel );
+            myHeadingSent = false;
+            myStopped = false;
+            return;
+        case MOTION_TARGET::TRANS_VEL:
+            myRobot->setVel( target.dVel );
+            break;
+        default:
+            myRobot->setVel( 0 );
+            break;
+    }
+
+    switch( target.eRot )
+    {
+        case MOTION_TARGET::ROT_VEL:
+            myRobot->setRotVel( target.dRotVel );
+            myHeadingSent = false;
+            break;
+        case MOTION_TARGET::ROT_DELTA_HEADING:
+            // Relative turns are one-shot; repeating one every cycle would
+            // keep adding to it
+            if( bDeltaPending )
+                myRobot->setDeltaHeading( target.dDeltaHeading );
+            myHeadingSent = false;
+            break;
+        case MOTION_TARGET::ROT_HEADING:
+            applyHeading( target.dHeading );
+            break;
+        default:
+            // Driving straight after aiming: finish the turn first
+            if( !turning() )
+            {
+                myRobot->setRotVel( 0 );
+                myHeadingSent = false;
+            }
+            break;
+    }
+    myStopped = false;
+}
@@ -0,0 +1,218 @@
+//-----------------------------------------------------------------------------
+// File: CommandScheduler.h
+//
+// Holds the motion the operator is asking for and applies it to ArRobot from
+// a sensor interpretation task, once per robot cycle.  Everything one input
+// frame asks for is merged into a single MOTION_TARGET first, so the robot
+// sees one batch of set calls inside the lock ArRobot already holds for its
+// sync tasks.  Callers never lock the robot, never take a mutex and never
+// sleep: a target is published to a lock-free mailbox that the task takes
+// once per cycle.  A target that is not refreshed before its deadline stops
+// the robot.
+//
+// The task runs right after the SIP is handled and before the state
+// reflector, so a target lands in the packet sent that same cycle instead of
+// waiting a whole cycle as a user task would.  The robot's cycle time
+// follows the measured SIP interval so the cycle stays locked to the packets.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "Aria.h"
+#include "CoalescingConnection.h"
+#include "LatencyHistogram.h"
+#include "LatestValueSlot.h"
+
+#define COMMAND_HOLD_MS 250    // A target not refreshed for this long stops the robot
+#define HEADING_RESEND_DEG 5.0 // setHeading again only when the target moves this much
+#define CYCLE_ADAPT_MS 2000    // how often the cycle time is matched to the SIP interval
+#define CYCLE_MIN_MS 20        // range the adapted cycle time is kept in
+#define CYCLE_MAX_MS 200
+
+struct MOTION_TARGET
+{
+    enum TransMode { TRANS_NONE, TRANS_VEL, TRANS_VEL2 };
+    enum RotMode   { ROT_NONE, ROT_VEL, ROT_DELTA_HEADING, ROT_HEADING };
+
+    TransMode eTrans;
+    double    dVel;            // mm/s, TRANS_VEL
+    double    dLeftVel;        // mm/s, TRANS_VEL2
+    double    dRightVel;       // mm/s, TRANS_VEL2
+
+    RotMode   eRot;            // ignored with TRANS_VEL2, which sets both wheels
+    double    dRotVel;         // deg/s, ROT_VEL
+    double    dDeltaHeading;   // deg, ROT_DELTA_HEADING
+    double    dHeading;        // deg in the odometry frame, ROT_HEADING
+
+    long long llInputUs;       // MonotonicMicros() of the newest input behind it, 0 if unknown
+
+    MOTION_TARGET() : eTrans( TRANS_NONE ), dVel( 0 ), dLeftVel( 0 ), dRightVel( 0 ),
+                      eRot( ROT_NONE ), dRotVel( 0 ), dDeltaHeading( 0 ), dHeading( 0 ),
+                      llInputUs( 0 ) {}
+
+    bool isIdle() const { return eTrans == TRANS_NONE && eRot == ROT_NONE; }
+
+    // Same motion, whatever input it came from
+    bool sameMotion( const MOTION_TARGET &other ) const
+    {
+        return eTrans == other.eTrans && dVel == other.dVel &&
+               dLeftVel == other.dLeftVel && dRightVel == other.dRightVel &&
+               eRot == other.eRot && dRotVel == other.dRotVel &&
+               dDeltaHeading == other.dDeltaHeading && dHeading == other.dHeading;
+    }
+
+    // Drop what cannot be applied together, so the target says exactly what
+    // the robot will do: setVel2 drives both wheels, which leaves no room
+    // for a separate rotation
+    void resolve()
+    {
+        if( eTrans == TRANS_VEL2 )
+        {
+            eRot = ROT_NONE;
+            dRotVel = 0;
+            dDeltaHeading = 0;
+            dHeading = 0;
+        }
+    }
+
+    // Take every component other sets and keep ours where it sets nothing
+    void overlay( const MOTION_TARGET &other )
+    {
+        if( other.eTrans != TRANS_NONE )
+        {
+            eTrans = other.eTrans;
+            dVel = other.dVel;
+            dLeftVel = other.dLeftVel;
+            dRightVel = other.dRightVel;
+        }
+        if( other.eRot != ROT_NONE )
+        {
+            eRot = other.eRot;
+            dRotVel = other.dRotVel;
+            dDeltaHeading = other.dDeltaHeading;
+            dHeading = other.dHeading;
+        }
+        if( other.llInputUs > llInputUs )
+            llInputUs = other.llInputUs;
+    }
+};
+
+// One submit() on its way to the robot cycle
+struct MOTION_MAIL
+{
+    MOTION_TARGET target;
+    unsigned int  uVersion;    // counts submits, from 1
+    long long     llSubmitUs;  // MonotonicMicros()
+
+    MOTION_MAIL() : uVersion( 0 ), llSubmitUs( 0 ) {}
+};
+
+// Where a stick movement spends its time on the way to the robot
+enum LATENCY_STAGE
+{
+    LATENCY_INPUT_TO_SUBMIT,    // pad sampled -> drive thread submits the target
+    LATENCY_SUBMIT_TO_CYCLE,    // submitted -> robot cycle applies it
+    LATENCY_CYCLE_TO_SEND,      // applied -> motion command packet written to the robot's connection
+    LATENCY_INPUT_TO_SEND,      // the whole way
+    LATENCY_STAGES
+};
+
+class CommandScheduler
+{
+public:
+    CommandScheduler( ArRobot *robot, int holdMs = COMMAND_HOLD_MS );
+    ~CommandScheduler();
+
+    // Replace the current target.  It stays in effect until the next
+    // submit() or until holdMs pass, whichever comes first.  One thread
+    // only, the same one that calls keepAlive().
+    void submit( const MOTION_TARGET &target );
+    // Push the deadline out without changing the target, for callers that
+    // know their input has not changed
+    void keepAlive();
+
+    // How many times a target ran out before it was refreshed
+    unsigned int getExpiredCount() const { return myExpiredCount; }
+    // Targets replaced by a newer submit() before a cycle took them
+    unsigned int getSupersededCount() const { return mySupersededCount; }
+    // setHeading calls made, and headings the robot reported reaching
+    unsigned int getHeadingCommands() const { return myHeadingCommands; }
+    unsigned int getHeadingsReached() const { return myHeadingsReached; }
+
+    // Smoothed time between SIPs and between submitted targets, in ms, 0
+    // until measured; and how often the cycle time was changed
+    double getPacketIntervalMs() const { return myPacketIntervalMs; }
+    double getInputIntervalMs() const { return myInputIntervalMs; }
+    unsigned int getCycleChanges() const { return myCycleChanges; }
+    // Turn off to leave the robot's cycle time alone; any thread
+    void setAdaptCycle( bool bAdapt ) { myAdaptCycle.store( bAdapt ); }
+
+    // The robot's commands are queued by conn and written at the end of the
+    // cycle, so a packet counts as sent when conn writes it.  nullptr before
+    // conn is deleted.
+    void sendThrough( CoalescingConnection *conn );
+
+    // MonotonicMicros() of the first motion command sent for a target, 0
+    // before it
+    long long getFirstSendUs() const { return myFirstSendUs.load(); }
+
+    // Latency per stage; any thread may read or reset them
+    LatencyHistogram *getLatency( LATENCY_STAGE stage ) { return &myLatency[stage]; }
+    // One ArLog line per stage, each starting with prefix
+    void logLatency( const char *prefix );
+
+protected:
+    void task();
+    void stop( bool bLetTurnFinish );
+    void applyHeading( double heading );
+    bool turning();
+    void packetSent( ArRobotPacket *packet );
+    void packetsWritten();
+    void closeSend( long long llAppliedUs, long long llInputUs );
+    void adaptCycle();
+
+    ArRobot *myRobot;
+    int myHoldMs;
+
+    // Submitting thread to robot thread.  The deadline is stored before the
+    // mail is published, so a cycle that takes a target sees its deadline.
+    LatestValueSlot<MOTION_MAIL> myMailbox;
+    std::atomic<long long> myDeadlineUs;
+
+    // Only touched from the submitting thread
+    unsigned int myVersion;
+    long long mySubmitUs;
+    double myInputIntervalMs;
+
+    // Only touched from the robot thread
+    MOTION_TARGET myTarget;
+    bool myHaveTarget;
+    unsigned int myTakenVersion;
+    unsigned int mySupersededCount;
+    bool myStopped;
+    unsigned int myExpiredCount;
+    bool myHeadingSent;        // a setHeading is in effect
+    bool myHeadingReached;     // and isHeadingDone() said so
+    double mySentHeading;
+    unsigned int myHeadingCommands;
+    unsigned int myHeadingsReached;
+    MOTION_TARGET myAppliedTarget;
+    std::atomic<bool> myAdaptCycle;
+    ArTime myLastPacketTime;
+    ArTime myLastAdapt;
+    double myPacketIntervalMs;
+    unsigned int myCycleChanges;
+
+    // Set when a changed target is applied, taken by the next motion packet
+    std::atomic<long long> myAppliedUs;
+    std::atomic<long long> myAppliedInputUs;
+    // The same, moved here by a motion packet that conn has only queued
+    CoalescingConnection *myConn;
+    std::atomic<long long> myQueuedUs;
+    std::atomic<long long> myQueuedInputUs;
+    std::atomic<long long> myFirstSendUs;
+    LatencyHistogram myLatency[LATENCY_STAGES];
+
+    ArFunctorC<CommandScheduler> myTaskCB;
+    ArFunctor1C<CommandScheduler, ArRobotPacket *> myPacketSentCB;
+    ArFunctorC<CommandScheduler> myPacketsWrittenCB;
+};
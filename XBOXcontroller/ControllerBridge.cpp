@@ -0,0 +1,761 @@
+//-----------------------------------------------------------------------------
+// File: ControllerBridge.cpp
+//
+// Pads to robots, without the user interface
+//-----------------------------------------------------------------------------
+#include "ControllerBridge.h"
+#include "HighResClock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+ControllerBridge::ControllerBridge( GamepadSource *pads ) :
+    myStartUs( MonotonicMicros() ),
+    myMode( BRIDGE_WINDOW ),
+    myPads( pads ),
+    mySource( pads ),
+    myInputThread( pads ),
+    myParser( nullptr ),
+    myRobotConnector( nullptr ),
+    myGyro( nullptr ),
+    myDispatcher( nullptr ),
+    myLaserConnector( nullptr ),
+    myCompassConnector( nullptr ),
+    myKeyHandler( nullptr ),
+    myCompass( nullptr ),
+    myCoalescing( nullptr ),
+    myPacketTap( nullptr ),
+    myPacketRecorder( nullptr ),
+    myLaserTask( nullptr ),
+    myCompassTask( nullptr ),
+    myStickCurveName( "expo" ),
+    myStickModeName( "arcade" ),
+    myStickMaxVel( STICK_MAX_TRANS_VEL ),
+    myStickMaxRotVel( STICK_MAX_ROT_VEL ),
+    myStickExpo( 0.6 ),
+    myTriggerGain( TRIGGER_ROT_GAIN ),
+    myTriggerSlew( TRIGGER_ROT_SLEW ),
+    myRecordInputName( nullptr ),
+    myReplayInputName( nullptr ),
+    myReplayTimingName( "original" ),
+    myPadArbitrationName( "owner" ),
+    myHeadingModeName( "servo" ),
+    myDriveModeName( "direct" ),
+    myAdaptCycleName( "on" ),
+    myRumbleName( "on" ),
+    myCoalesceName( "on" ),
+    myRecordPacketsName( nullptr ),
+    myTelemetryPort( 0 ),
+    myShortcuts( nullptr ),
+    myShortcutCount( 0 ),
+    myReplay( nullptr ),
+    myRecorder( nullptr ),
+    myConnectedMask( 0 ),
+    myNetServer( false, true ),
+    myDebugMessageCB( this, &ControllerBridge::handleDebugMessage ),
+    myConnectCB( this, &ControllerBridge::handleConnect ),
+    myDisconnectCB( this, &ControllerBridge::handleDisconnect ),
+    myTelemetryTaskCB( this, &ControllerBridge::telemetryTask ),
+    myReadyTaskCB( this, &ControllerBridge::readyTask ),
+    myConnectLasersCB( this, &ControllerBridge::connectLasers ),
+    myConnectCompassCB( this, &ControllerBridge::connectCompass ),
+    myNetStatusCB( this, &ControllerBridge::netStatus ),
+    myNetTelemetryCB( this, &ControllerBridge::netTelemetry )
+{
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        myPadRobotHosts[i] = nullptr;
+        myPadRobots[i] = nullptr;
+        myBindings[i] = nullptr;
+        myFeedback[i] = nullptr;
+        myPadRobotTasks[i] = nullptr;
+        myPadRobotCBs[i] = nullptr;
+    }
+    for( int i = 0; i < BUTTON_MAX_ACTIONS; i++ )
+        myPadActions[i] = nullptr;
+}
+
+
+//-----------------------------------------------------------------------------
+ControllerBridge::~ControllerBridge()
+{
+    stop();
+    finishStartup();
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+        delete myPadRobots[i];
+    delete myKeyHandler;
+    delete myCompassConnector;
+    delete myLaserConnector;
+    delete myDispatcher;
+    delete myGyro;
+    delete myRobotConnector;
+    delete myParser;
+}
+
+
+//-----------------------------------------------------------------------------
+void ControllerBridge::setPadAction( int action, ArFunctor1<int> *functor )
+{
+    if( action >= 0 && action < BUTTON_MAX_ACTIONS )
+        myPadActions[action] = functor;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: connect()
+// Desc: Connect the main robot and start its task loop.  Only the base is
+//       waited for: pad robots connect on their own threads while it does,
+//       and lasers and the compass on theirs once it is up.
+//-----------------------------------------------------------------------------
+bool ControllerBridge::connect( int *argc, char **argv, BRIDGE_MODE mode )
+{
+    myMode = mode;
+    if( mode != BRIDGE_WINDOW )
+        myTelemetryPort = TELEMETRY_PORT;
+
+    // This object parses program options from the command line
+    myParser = new ArArgumentParser( argc, argv );
+
+    // Load some default values for command line arguments from /etc/Aria.args
+    // (Linux) or the ARIAARGS environment variable.
+    myParser->loadDefaultArguments();
+
+    // Our options only read the arguments, so they can be had before the
+    // robot connects; that way the pad robots are known in time to connect
+    // alongside it
+    parseOptions();
+    static const char *PAD_ROBOT_TASK_NAMES[MAX_CONTROLLERS] = { "pad robot 0", "pad robot 1", "pad robot 2", "pad robot 3" };
+    for( int i = 1; i < MAX_CONTROLLERS; i++ )
+    {
+        if( myPadRobotHosts[i] == nullptr )
+            continue;
+        myPadRobots[i] = new PadRobot( i );
+        myPadRobotCBs[i] = new ArRetFunctor1C<bool, PadRobot, const char *>( myPadRobots[i], &PadRobot::connect, myPadRobotHosts[i] );
+        myPadRobotTasks[i] = new StartupTask( PAD_ROBOT_TASK_NAMES[i], myPadRobotCBs[i], myStartUs );
+        myPadRobotTasks[i]->start();
+    }
+
+    // Object that connects to the robot or simulator using program options
+    myRobotConnector = new ArRobotConnector( myParser, &myRobot );
+
+    // If the robot has an Analog Gyro, this object will activate it, and
+    // if the robot does not automatically use the gyro to correct heading,
+    // this object reads data from it and corrects the pose in ArRobot
+    myGyro = new ArAnalogGyro( &myRobot );
+
+    myDispatcher = new PacketDispatcher( &myRobot );
+    myDispatcher->addHandler( ArCommands::MARCDEBUG, &myDebugMessageCB );
+
+    // Connect to the robot, get some initial data from it such as type and name,
+    // and then load parameter files for this robot.
+    if( !myRobotConnector->connectRobot() )
+    {
+        // Error connecting:
+        // if the user gave the -help argument, then just print out what happened,
+        // and continue so options can be displayed later.
+        if( !myParser->checkHelpAndWarnUnparsed() )
+        {
+            ArLog::log( ArLog::Terse, "Could not connect to robot, will not have parameter file so options displayed later may not include everything" );
+        }
+        // otherwise abort
+        else
+        {
+            ArLog::log( ArLog::Terse, "Error, could not connect to robot." );
+            Aria::logOptions();
+            return false;
+        }
+    }
+
+    if( !myRobot.isConnected() )
+    {
+        ArLog::log( ArLog::Terse, "Internal error: robot connector succeeded but ArRobot::isConnected() is false!" );
+    }
+
+    // Connector for laser rangefinders
+    myLaserConnector = new ArLaserConnector( myParser, &myRobot, myRobotConnector );
+
+    // Connector for compasses
+    myCompassConnector = new ArCompassConnector( myParser );
+
+    // Parse the command line options. Fail and print the help message if the parsing fails
+    // or if the help was requested with the -help option
+    if( !Aria::parseArgs() || !myParser->checkHelpAndWarnUnparsed() )
+    {
+        Aria::logOptions();
+        return false;
+    }
+
+    // Used to perform actions when keyboard keys are pressed.  A daemon has
+    // no keyboard.
+    if( mode != BRIDGE_DAEMON )
+    {
+        myKeyHandler = new ArKeyHandler;
+        Aria::setKeyHandler( myKeyHandler );
+
+        // ArRobot contains an exit action for the Escape key. It also
+        // stores a pointer to the keyhandler so that other parts of the program can
+        // use the same keyhandler.
+        myRobot.attachKeyHandler( myKeyHandler );
+        printf( "You may press escape to exit\n" );
+    }
+
+    // Attach the sonar to the robot so it gets data from it.
+    myRobot.addRangeDevice( &mySonar );
+
+    // One write per cycle for the commands to the robot
+    if( strcmp( myCoalesceName, "off" ) != 0 && myRobot.isConnected() )
+        myCoalescing = new CoalescingConnection( &myRobot );
+
+    // The robot's packets, to a file without holding up the robot cycle
+    if( myRecordPacketsName != nullptr && myRobot.isConnected() )
+    {
+        myPacketTap = new PacketTap( &myRobot );
+        myPacketRecorder = new PacketRecorder( myPacketTap );
+        if( myPacketRecorder->open( myRecordPacketsName ) )
+            myPacketRecorder->runAsync();
+        else
+            ArLog::log( ArLog::Terse, "Could not create packet log '%s'", myRecordPacketsName );
+    }
+
+    // Tells connect() when the task loop has the robot's state
+    myRobot.addSensorInterpTask( "ControllerBridge startup", 5, &myReadyTaskCB );
+
+    // Start the robot task loop running in a new background thread. The 'true' argument means if it loses
+    // connection the task loop stops and the thread exits.
+    myRobot.runAsync( true );
+    ArLog::log( ArLog::Normal, "Startup: robot connected %lld ms after start", ( MonotonicMicros() - myStartUs ) / 1000 );
+
+    // The lasers and the compass only add to what the robot can do, so the
+    // pads do not wait for them
+    myLaserTask = new StartupTask( "lasers", &myConnectLasersCB, myStartUs );
+    myLaserTask->start();
+    myCompassTask = new StartupTask( "compass", &myConnectCompassCB, myStartUs );
+    myCompassTask->start();
+
+    if( mode == BRIDGE_WINDOW )
+    {
+        settle();
+    }
+    else
+    {
+        // Nobody is watching the robot start up; just enable the motors
+        myRobot.lock();
+        myRobot.enableMotors();
+        myRobot.unlock();
+    }
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: connectLasers()
+// Desc: On a StartupTask
+//-----------------------------------------------------------------------------
+bool ControllerBridge::connectLasers()
+{
+    // Connect to the laser(s) if lasers were configured in this robot's parameter
+    // file or on the command line, and run laser processing thread if applicable
+    // for that laser class.  Add all possible lasers to ArRobot's list rather
+    // than just the ones that were connected by this call.
+    if( !myLaserConnector->connectLasers(
+            false,  // continue after connection failures
+            false,  // add only connected lasers to ArRobot
+            true    // add all lasers to ArRobot
+        ) )
+    {
+        printf( "Warning: Could not connect to laser(s). Set LaserAutoConnect to false in this robot's individual parameter file to disable laser connection.\n" );
+        return false;
+    }
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: connectCompass()
+// Desc: On a StartupTask.  No compass to connect counts as ready.
+//-----------------------------------------------------------------------------
+bool ControllerBridge::connectCompass()
+{
+    // Create and connect to the compass if the robot has one.
+    ArTCM2 *compass = myCompassConnector->create( &myRobot );
+    if( compass && !compass->blockingConnect() )
+    {
+        return false;
+    }
+    myCompass = compass;
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: readyTask()
+// Desc: ArRobot sensor interp task.  The first run means a SIP has been
+//       handled since the task loop started.
+//-----------------------------------------------------------------------------
+void ControllerBridge::readyTask()
+{
+    if( !myFirstCycle.isSet() )
+        myFirstCycle.set( true );
+    if( !myMotorsReady.isSet() && myRobot.areMotorsEnabled() )
+        myMotorsReady.set( true );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: finishStartup()
+// Desc: Wait for anything still connecting and let go of the workers
+//-----------------------------------------------------------------------------
+void ControllerBridge::finishStartup()
+{
+    delete myLaserTask;
+    myLaserTask = nullptr;
+    delete myCompassTask;
+    myCompassTask = nullptr;
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        delete myPadRobotTasks[i];
+        myPadRobotTasks[i] = nullptr;
+        delete myPadRobotCBs[i];
+        myPadRobotCBs[i] = nullptr;
+    }
+    myRobot.lock();
+    myRobot.remSensorInterpTask( &myReadyTaskCB );
+    myRobot.unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: parseOptions()
+//-----------------------------------------------------------------------------
+void ControllerBridge::parseOptions()
+{
+    ArArgumentParser &parser = *myParser;
+
+    // Stick response options
+    //   -stickCurve linear|expo|cubic   -stickMode arcade|tank
+    //   -stickMaxVel <mm/s>             -stickMaxRotVel <deg/s>
+    //   -stickExpo <0..1>
+    parser.checkParameterArgumentString( "-stickCurve", &myStickCurveName );
+    parser.checkParameterArgumentString( "-stickMode", &myStickModeName );
+    parser.checkParameterArgumentDouble( "-stickMaxVel", &myStickMaxVel );
+    parser.checkParameterArgumentDouble( "-stickMaxRotVel", &myStickMaxRotVel );
+    parser.checkParameterArgumentDouble( "-stickExpo", &myStickExpo );
+
+    // Trigger rotation options
+    //   -triggerGain <deg/s>            rotation at a fully pulled trigger
+    //   -triggerSlew <deg/s/s>          how fast trigger rotation may change, 0 for no limit
+    parser.checkParameterArgumentDouble( "-triggerGain", &myTriggerGain );
+    parser.checkParameterArgumentDouble( "-triggerSlew", &myTriggerSlew );
+
+    // Input record/replay options
+    //   -recordInput <file>             log every controller change
+    //   -replayInput <file>             drive from a log instead of the pads
+    //   -replayTiming original|fast
+    parser.checkParameterArgumentString( "-recordInput", &myRecordInputName );
+    parser.checkParameterArgumentString( "-replayInput", &myReplayInputName );
+    parser.checkParameterArgumentString( "-replayTiming", &myReplayTimingName );
+
+    // Pad arbitration options
+    //   -padArbitration owner|merge     how pads sharing a robot combine
+    //   -padRobot1 <host[:port]>        give pad 1 its own robot (also 2, 3)
+    parser.checkParameterArgumentString( "-padArbitration", &myPadArbitrationName );
+    parser.checkParameterArgumentString( "-padRobot1", &myPadRobotHosts[1] );
+    parser.checkParameterArgumentString( "-padRobot2", &myPadRobotHosts[2] );
+    parser.checkParameterArgumentString( "-padRobot3", &myPadRobotHosts[3] );
+
+    // Right stick option
+    //   -headingMode servo|steps        hold the stick's direction, or turn by 45 degree steps
+    parser.checkParameterArgumentString( "-headingMode", &myHeadingModeName );
+
+    // Drive path option
+    //   -driveMode direct|actions       motion commands from the pads, or ratios
+    //                                   through ARIA's actions and their limiters
+    parser.checkParameterArgumentString( "-driveMode", &myDriveModeName );
+
+    // Robot cycle option
+    //   -adaptCycle on|off              match the robot's cycle time to its SIP interval
+    parser.checkParameterArgumentString( "-adaptCycle", &myAdaptCycleName );
+
+    // Feedback option
+    //   -rumble on|off                  rumble the pads as their robot nears an obstacle
+    parser.checkParameterArgumentString( "-rumble", &myRumbleName );
+
+    // Command packet option
+    //   -coalesceCommands on|off        send each cycle's commands in one write,
+    //                                   keeping only the last of each setting
+    parser.checkParameterArgumentString( "-coalesceCommands", &myCoalesceName );
+
+    // Packet log option
+    //   -recordPackets <file>           log every packet from the robot
+    parser.checkParameterArgumentString( "-recordPackets", &myRecordPacketsName );
+
+    // Telemetry option
+    //   -telemetryPort <port>           serve status and telemetry, 0 for none
+    parser.checkParameterArgumentInteger( "-telemetryPort", &myTelemetryPort );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: settle()
+// Desc: Wait until the task loop has the robot's first state, then until the
+//       robot reports its motors enabled, so the window shows a robot that
+//       is ready to move.  Each wait ends as soon as its condition holds.
+//-----------------------------------------------------------------------------
+void ControllerBridge::settle()
+{
+    if( !myFirstCycle.wait( STARTUP_ROBOT_WAIT_MS ) )
+        ArLog::log( ArLog::Terse, "Startup: no robot cycle after %d ms", STARTUP_ROBOT_WAIT_MS );
+
+    myRobot.lock();
+    myRobot.enableMotors();
+    myRobot.unlock();
+    if( !myMotorsReady.wait( STARTUP_ROBOT_WAIT_MS ) )
+        ArLog::log( ArLog::Terse, "Startup: motors not enabled after %d ms", STARTUP_ROBOT_WAIT_MS );
+    myRobot.lock();
+    myRobot.setVel( 0 );
+    myRobot.unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: start()
+// Desc: Pads given their own robot get their own binding; the rest share the
+//       main robot.  Each scheduler applies its drive thread's targets once
+//       per robot cycle.
+//-----------------------------------------------------------------------------
+void ControllerBridge::start()
+{
+    RESPONSE_CURVE stickCurve = CURVE_EXPO;
+    if( !ParseResponseCurve( myStickCurveName, &stickCurve ) )
+        ArLog::log( ArLog::Terse, "Unknown -stickCurve '%s', using expo", myStickCurveName );
+    DRIVE_ARBITRATION padArbitration = strcmp( myPadArbitrationName, "merge" ) == 0 ? ARBITRATE_MERGE : ARBITRATE_OWNER;
+    HEADING_MODE headingMode = strcmp( myHeadingModeName, "steps" ) == 0 ? HEADING_STEPS : HEADING_SERVO;
+    bool bDriveActions = strcmp( myDriveModeName, "actions" ) == 0;
+    bool bAdaptCycle = strcmp( myAdaptCycleName, "off" ) != 0;
+    bool bRumble = strcmp( myRumbleName, "off" ) != 0;
+
+    // The pad robots have been connecting since connect(); a pad's binding
+    // depends on whether its robot made it
+    unsigned int sharedMask = ( 1 << MAX_CONTROLLERS ) - 1;
+    for( int i = 1; i < MAX_CONTROLLERS; i++ )
+    {
+        if( myPadRobotTasks[i] == nullptr )
+            continue;
+        bool bConnected = myPadRobotTasks[i]->finish();
+        delete myPadRobotTasks[i];
+        myPadRobotTasks[i] = nullptr;
+        delete myPadRobotCBs[i];
+        myPadRobotCBs[i] = nullptr;
+        if( !bConnected )
+        {
+            delete myPadRobots[i];
+            myPadRobots[i] = nullptr;
+            continue;
+        }
+        myBindings[i] = new PadBinding( myPadRobots[i]->getRobot(), myInputThread.addDriveSlot(), 1 << i );
+        sharedMask &= ~( 1 << i );
+    }
+    myBindings[0] = new PadBinding( &myRobot, myInputThread.addDriveSlot(), sharedMask );
+    if( myCoalescing != nullptr )
+        myBindings[0]->getScheduler()->sendThrough( myCoalescing );
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        if( myBindings[i] == nullptr )
+            continue;
+        myBindings[i]->getScheduler()->setAdaptCycle( bAdaptCycle );
+        if( bDriveActions )
+        {
+            myBindings[i]->driveWithActions( myStickMaxVel, myStickMaxRotVel );
+            continue;
+        }
+        RobotDriveThread *driveThread = myBindings[i]->getDriveThread();
+        driveThread->getStickMapper()->setLimits( myStickMaxVel, myStickMaxRotVel );
+        driveThread->getStickMapper()->setMode( strcmp( myStickModeName, "tank" ) == 0 ? STICK_TANK : STICK_ARCADE );
+        driveThread->setArbitration( padArbitration );
+        driveThread->setHeadingMode( headingMode );
+        driveThread->setTriggerRotation( myTriggerGain, myTriggerSlew );
+        if( myShortcuts != nullptr )
+            driveThread->getButtonBindings()->addRules( myShortcuts, myShortcutCount );
+        for( int action = DRIVE_ACTION_FIRST_FREE; action < BUTTON_MAX_ACTIONS; action++ )
+        {
+            if( myPadActions[action] != nullptr )
+                driveThread->getButtonBindings()->setAction( action, myPadActions[action] );
+        }
+        driveThread->runAsync();
+    }
+
+    // Controllers, or a log of them, possibly recorded on the way
+    if( myReplayInputName != nullptr )
+    {
+        myReplay = new GamepadReplay( strcmp( myReplayTimingName, "fast" ) == 0 ? GamepadReplay::REPLAY_FAST : GamepadReplay::REPLAY_ORIGINAL );
+        if( myReplay->load( myReplayInputName ) )
+            mySource = myReplay;
+        else
+            ArLog::log( ArLog::Terse, "Could not read input log '%s', using the controllers", myReplayInputName );
+    }
+    if( myRecordInputName != nullptr )
+    {
+        myRecorder = new GamepadRecorder( mySource );
+        if( myRecorder->open( myRecordInputName ) )
+            mySource = myRecorder;
+        else
+            ArLog::log( ArLog::Terse, "Could not create input log '%s'", myRecordInputName );
+    }
+    mySource->addConnectCB( &myConnectCB );
+    mySource->addDisconnectCB( &myDisconnectCB );
+    for( int i = 0; bRumble && i < MAX_CONTROLLERS; i++ )
+    {
+        if( myBindings[i] == nullptr )
+            continue;
+        ArRobot *bindingRobot = i == 0 ? &myRobot : myPadRobots[i]->getRobot();
+        myFeedback[i] = new ProximityFeedback( bindingRobot, mySource, myBindings[i]->getPadMask() );
+        myFeedback[i]->runAsync();
+    }
+    myInputThread.setSource( mySource );
+    myInputThread.setCurve( stickCurve, float( myStickExpo ) );
+    myInputThread.runAsync();
+
+    // Status for whoever asks over the network
+    myRobot.lock();
+    myRobot.addUserTask( "ControllerBridge telemetry", 40, &myTelemetryTaskCB );
+    myRobot.unlock();
+    if( myTelemetryPort > 0 )
+    {
+        if( myNetServer.open( &myRobot, myTelemetryPort, "", true ) )
+        {
+            myNetServer.addCommand( "status", &myNetStatusCB, "one line of robot and input status" );
+            myNetServer.addCommand( "telemetry", &myNetTelemetryCB, "telemetry [n]: the last n samples, oldest first" );
+        }
+        else
+            ArLog::log( ArLog::Terse, "Could not serve telemetry on port %d", myTelemetryPort );
+    }
+
+    ArLog::log( ArLog::Normal, "Startup: ready to drive %lld ms after start", ( MonotonicMicros() - myStartUs ) / 1000 );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: stop()
+//-----------------------------------------------------------------------------
+void ControllerBridge::stop()
+{
+    finishStartup();
+    if( myCoalescing != nullptr )
+    {
+        ArLog::log( ArLog::Normal, "Commands: %u packets, %u superseded, sent in %u writes",
+                    myCoalescing->getPackets(), myCoalescing->getDropped(), myCoalescing->getWrites() );
+        if( myBindings[0] != nullptr )
+            myBindings[0]->getScheduler()->sendThrough( nullptr );
+        delete myCoalescing;
+        myCoalescing = nullptr;
+    }
+    if( myPacketTap != nullptr )
+    {
+        ArLog::log( ArLog::Normal, "Packets: %u records written to %s, %u dropped with the queue full",
+                    myPacketRecorder->getRecords(), myRecordPacketsName, myPacketRecorder->getDropped() );
+        delete myPacketRecorder;
+        myPacketRecorder = nullptr;
+        PacketPool *pool = myPacketTap->getPool();
+        ArLog::log( ArLog::Normal, "Packets: %u received, %u pooled, pool empty %u times, %u heap allocations",
+                    myPacketTap->getPackets(), pool->getAcquired(), pool->getExhausted(), pool->getHeapAllocations() );
+        delete myPacketTap;
+        myPacketTap = nullptr;
+    }
+    if( myBindings[0] == nullptr )
+        return;
+
+    if( myNetServer.isOpen() )
+        myNetServer.close();
+    myRobot.lock();
+    myRobot.remUserTask( &myTelemetryTaskCB );
+    myRobot.unlock();
+
+    myInputThread.stopRunning();
+    myInputThread.join();
+
+    if( mySource == myRecorder )
+        ArLog::log( ArLog::Normal, "Input: %u records written to %s", myRecorder->getRecords(), myRecordInputName );
+    ArLog::log( ArLog::Normal, "Input: %u of %u samples unchanged",
+                myInputThread.getUnchangedSamples(), myInputThread.getSamples() );
+    long long firstCommandMs = getFirstCommandMs();
+    if( firstCommandMs >= 0 )
+        ArLog::log( ArLog::Normal, "Startup: first motion command %lld ms after start", firstCommandMs );
+    logLatency();
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        PadBinding *binding = myBindings[i];
+        if( binding == nullptr )
+            continue;
+        myBindings[i] = nullptr;
+        if( myFeedback[i] != nullptr )
+        {
+            ArLog::log( ArLog::Normal, "Feedback %d: %u rumble updates", i, myFeedback[i]->getUpdates() );
+            delete myFeedback[i];
+            myFeedback[i] = nullptr;
+        }
+        RobotDriveThread *driveThread = binding->getDriveThread();
+        ArLog::log( ArLog::Normal, "Drive %d (pads 0x%x): %u of %u snapshots skipped, %u ownership changes, %u headings sent, %u reached",
+                    i, binding->getPadMask(), driveThread->getSkippedSnapshots(), driveThread->getSnapshots(),
+                    driveThread->getHandoffs(), binding->getScheduler()->getHeadingCommands(),
+                    binding->getScheduler()->getHeadingsReached() );
+        ArLog::log( ArLog::Normal, "Drive %d: SIP every %.1f ms, input every %.1f ms, %u cycle time changes, %u targets superseded",
+                    i, binding->getScheduler()->getPacketIntervalMs(), binding->getScheduler()->getInputIntervalMs(),
+                    binding->getScheduler()->getCycleChanges(), binding->getScheduler()->getSupersededCount() );
+        delete binding;
+        delete myPadRobots[i];
+        myPadRobots[i] = nullptr;
+    }
+
+    mySource->remConnectCB( &myConnectCB );
+    mySource->remDisconnectCB( &myDisconnectCB );
+    mySource = myPads;
+    delete myRecorder;
+    myRecorder = nullptr;
+    delete myReplay;
+    myReplay = nullptr;
+}
+
+
+//-----------------------------------------------------------------------------
+void ControllerBridge::setEasyRotate( bool bOn )
+{
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        if( myBindings[i] != nullptr )
+            myBindings[i]->getDriveThread()->setEasyRotate( bOn );
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+void ControllerBridge::logLatency()
+{
+    char prefix[32];
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        if( myBindings[i] == nullptr )
+            continue;
+        sprintf( prefix, "Latency drive %d", i );
+        myBindings[i]->getScheduler()->logLatency( prefix );
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+long long ControllerBridge::getFirstCommandMs()
+{
+    long long first = 0;
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        if( myBindings[i] == nullptr )
+            continue;
+        long long sent = myBindings[i]->getScheduler()->getFirstSendUs();
+        if( sent != 0 && ( first == 0 || sent < first ) )
+            first = sent;
+    }
+    return first == 0 ? -1 : ( first - myStartUs ) / 1000;
+}
+
+
+//-----------------------------------------------------------------------------
+void ControllerBridge::handleConnect( int slot )
+{
+    myConnectedMask.fetch_or( 1u << slot );
+    ArLog::log( ArLog::Normal, "Controller %d connected", slot );
+}
+
+
+//-----------------------------------------------------------------------------
+void ControllerBridge::handleDisconnect( int slot )
+{
+    myConnectedMask.fetch_and( ~( 1u << slot ) );
+    ArLog::log( ArLog::Normal, "Controller %d disconnected", slot );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: handleDebugMessage()
+// Desc: The dispatcher only brings MARCDEBUG packets here
+//-----------------------------------------------------------------------------
+bool ControllerBridge::handleDebugMessage( ArRobotPacket *pkt )
+{
+    char msg[256];
+    pkt->bufToStr( msg, sizeof( msg ) );
+    msg[255] = 0;
+    ArLog::log( ArLog::Terse, "Controller Firmware Debug: %s", msg );
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: telemetryTask()
+// Desc: ArRobot user task, so the robot is locked; one sample every
+//       TELEMETRY_PERIOD_MS
+//-----------------------------------------------------------------------------
+void ControllerBridge::telemetryTask()
+{
+    if( myLastTelemetry.mSecSince() < TELEMETRY_PERIOD_MS )
+        return;
+    myLastTelemetry.setToNow();
+
+    TELEMETRY_SAMPLE sample;
+    sample.llTimeUs = MonotonicMicros();
+    sample.uPadsConnected = myConnectedMask.load();
+    sample.iOwner = myBindings[0]->getDriveThread()->getOwner();
+    sample.fX = float( myRobot.getX() );
+    sample.fY = float( myRobot.getY() );
+    sample.fTh = float( myRobot.getTh() );
+    sample.fVel = float( myRobot.getVel() );
+    sample.fRotVel = float( myRobot.getRotVel() );
+    sample.fBattery = float( myRobot.getRealBatteryVoltage() );
+    sample.uInputSamples = myInputThread.getSamples();
+    sample.uLatencyP99Us = (unsigned int)myBindings[0]->getScheduler()->getLatency( LATENCY_INPUT_TO_SEND )->getPercentile( 0.99 );
+    myTelemetry.push( sample );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: netStatus()
+// Desc: "status": the newest sample on one line
+//-----------------------------------------------------------------------------
+void ControllerBridge::netStatus( char **, int, ArSocket *socket )
+{
+    TELEMETRY_SAMPLE sample;
+    if( myTelemetry.copyLatest( &sample, 1 ) != 1 )
+    {
+        socket->writeString( "no telemetry yet" );
+        return;
+    }
+    socket->writeString( "pads 0x%x owner %d pose %.0f %.0f %.1f vel %.0f rotvel %.1f battery %.1f input %u samples, p99 %u us, first command %lld ms",
+                         sample.uPadsConnected, sample.iOwner, sample.fX, sample.fY, sample.fTh,
+                         sample.fVel, sample.fRotVel, sample.fBattery, sample.uInputSamples,
+                         sample.uLatencyP99Us, getFirstCommandMs() );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: netTelemetry()
+// Desc: "telemetry [n]": one line per sample, oldest first
+//-----------------------------------------------------------------------------
+void ControllerBridge::netTelemetry( char **argv, int argc, ArSocket *socket )
+{
+    int count = 10;
+    if( argc > 1 )
+        count = atoi( argv[1] );
+    if( count < 1 ) count = 1;
+    if( count > TELEMETRY_SAMPLES ) count = TELEMETRY_SAMPLES;
+
+    // The robot thread calls this, so keep the copy off its stack
+    static TELEMETRY_SAMPLE samples[TELEMETRY_SAMPLES];
+    int copied = myTelemetry.copyLatest( samples, count );
+    for( int i = 0; i < copied; i++ )
+    {
+        const TELEMETRY_SAMPLE &sample = samples[i];
+        socket->writeString( "%lld %x %d %.0f %.0f %.1f %.0f %.1f %.1f %u %u",
+                             ( sample.llTimeUs - myStartUs ) / 1000, sample.uPadsConnected, sample.iOwner,
+                             sample.fX, sample.fY, sample.fTh, sample.fVel, sample.fRotVel,
+                             sample.fBattery, sample.uInputSamples, sample.uLatencyP99Us );
+    }
+}
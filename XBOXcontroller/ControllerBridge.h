@@ -0,0 +1,164 @@
+//-----------------------------------------------------------------------------
+// File: ControllerBridge.h
+//
+// Everything between the pads and the robots that is not user interface:
+// connecting the main robot and its devices, the command line options, the
+// pad robots and bindings, rumble feedback, the input source chain and the
+// input thread, plus a telemetry ring served over ArNetServer.  The window
+// front end and the headless one both drive it the same way:
+//
+//     connect()  ->  start()  ->  ... run ...  ->  stop()
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "Gamepad.h"
+#include "ControllerInput.h"
+#include "PadBinding.h"
+#include "ProximityFeedback.h"
+#include "GamepadReplay.h"
+#include "ButtonBindings.h"
+#include "Telemetry.h"
+#include "StartupTask.h"
+#include "CoalescingConnection.h"
+#include "PacketRecorder.h"
+#include "PacketDispatcher.h"
+#include "Aria.h"
+
+#define TELEMETRY_PORT 7171       // default for the headless modes
+#define STARTUP_ROBOT_WAIT_MS 3000   // longest the window waits on the robot's first cycle and motors
+
+enum BRIDGE_MODE
+{
+    BRIDGE_WINDOW,     // Win32 front end: key handler, wait for the motors after connecting
+    BRIDGE_CONSOLE,    // headless with a console: key handler, telemetry
+    BRIDGE_DAEMON      // headless, detached: telemetry only
+};
+
+class ControllerBridge
+{
+public:
+    // pads is the platform's controller backend
+    ControllerBridge( GamepadSource *pads );
+    ~ControllerBridge();
+
+    // Parse the options and connect the main robot.  Pad robots connect
+    // alongside it; lasers and the compass are left connecting in the
+    // background.  Returns false when the program should exit instead (bad
+    // options or -help).
+    bool connect( int *argc, char **argv, BRIDGE_MODE mode );
+    // Bind the pads and start the threads, once the pad robots are settled
+    void start();
+    // Stop the threads, log the statistics and let go of the pad robots
+    void stop();
+
+    // Extra button rules for every drive thread, with their actions from
+    // DRIVE_ACTION_FIRST_FREE on; before start()
+    void setPadShortcuts( const BUTTON_RULE *rules, int count ) { myShortcuts = rules; myShortcutCount = count; }
+    void setPadAction( int action, ArFunctor1<int> *functor );
+
+    // Any thread
+    void setEasyRotate( bool bOn );
+    void logLatency();
+
+    ArRobot *getRobot() { return &myRobot; }
+    // Packet handlers by packet ID; null before connect()
+    PacketDispatcher *getPacketDispatcher() { return myDispatcher; }
+    ControllerInputThread *getInputThread() { return &myInputThread; }
+    GamepadSource *getSource() { return mySource; }
+    PadBinding *getBinding( int i ) { return myBindings[i]; }
+    // Null before connect() gets to them
+    Readiness *getLasersReady() { return myLaserTask != nullptr ? myLaserTask->getReady() : nullptr; }
+    Readiness *getCompassReady() { return myCompassTask != nullptr ? myCompassTask->getReady() : nullptr; }
+    // Milliseconds from construction to the first motion command, -1 if none yet
+    long long getFirstCommandMs();
+
+protected:
+    void parseOptions();
+    void settle();
+    void finishStartup();
+    bool connectLasers();
+    bool connectCompass();
+    void readyTask();
+    void telemetryTask();
+    void handleConnect( int slot );
+    void handleDisconnect( int slot );
+    void netStatus( char **argv, int argc, ArSocket *socket );
+    void netTelemetry( char **argv, int argc, ArSocket *socket );
+    bool handleDebugMessage( ArRobotPacket *pkt );
+
+    long long myStartUs;
+    BRIDGE_MODE myMode;
+    GamepadSource *myPads;
+    GamepadSource *mySource;
+    ControllerInputThread myInputThread;
+    ArRobot myRobot;
+
+    // Created by connect()
+    ArArgumentParser *myParser;
+    ArRobotConnector *myRobotConnector;
+    ArAnalogGyro *myGyro;
+    PacketDispatcher *myDispatcher;
+    ArLaserConnector *myLaserConnector;
+    ArCompassConnector *myCompassConnector;
+    ArSonarDevice mySonar;
+    ArKeyHandler *myKeyHandler;
+    ArTCM2 *myCompass;
+    CoalescingConnection *myCoalescing;
+    PacketTap *myPacketTap;
+    PacketRecorder *myPacketRecorder;
+
+    // Connections made in parallel
+    StartupTask *myLaserTask;
+    StartupTask *myCompassTask;
+    StartupTask *myPadRobotTasks[MAX_CONTROLLERS];
+    ArRetFunctor<bool> *myPadRobotCBs[MAX_CONTROLLERS];
+    // Set from the robot's own cycle
+    Readiness myFirstCycle;
+    Readiness myMotorsReady;
+
+    // Options
+    const char *myStickCurveName;
+    const char *myStickModeName;
+    double myStickMaxVel;
+    double myStickMaxRotVel;
+    double myStickExpo;
+    double myTriggerGain;
+    double myTriggerSlew;
+    const char *myRecordInputName;
+    const char *myReplayInputName;
+    const char *myReplayTimingName;
+    const char *myPadArbitrationName;
+    const char *myPadRobotHosts[MAX_CONTROLLERS];
+    const char *myHeadingModeName;
+    const char *myDriveModeName;
+    const char *myAdaptCycleName;
+    const char *myRumbleName;
+    const char *myCoalesceName;
+    const char *myRecordPacketsName;
+    int myTelemetryPort;
+
+    const BUTTON_RULE *myShortcuts;
+    int myShortcutCount;
+    ArFunctor1<int> *myPadActions[BUTTON_MAX_ACTIONS];
+
+    PadRobot *myPadRobots[MAX_CONTROLLERS];
+    PadBinding *myBindings[MAX_CONTROLLERS];
+    ProximityFeedback *myFeedback[MAX_CONTROLLERS];
+    GamepadReplay *myReplay;
+    GamepadRecorder *myRecorder;
+
+    std::atomic<unsigned int> myConnectedMask;
+    TelemetryRing myTelemetry;
+    ArTime myLastTelemetry;
+    ArNetServer myNetServer;
+
+    ArRetFunctor1C<bool, ControllerBridge, ArRobotPacket *> myDebugMessageCB;
+    ArFunctor1C<ControllerBridge, int> myConnectCB;
+    ArFunctor1C<ControllerBridge, int> myDisconnectCB;
+    ArFunctorC<ControllerBridge> myTelemetryTaskCB;
+    ArFunctorC<ControllerBridge> myReadyTaskCB;
+    ArRetFunctorC<bool, ControllerBridge> myConnectLasersCB;
+    ArRetFunctorC<bool, ControllerBridge> myConnectCompassCB;
+    ArFunctor3C<ControllerBridge, char **, int, ArSocket *> myNetStatusCB;
+    ArFunctor3C<ControllerBridge, char **, int, ArSocket *> myNetTelemetryCB;
+};
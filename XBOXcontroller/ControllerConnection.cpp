@@ -0,0 +1,73 @@
+//-----------------------------------------------------------------------------
+// File: ControllerConnection.cpp
+//
+// Decides which XInput slots GamepadXInput reads
+//-----------------------------------------------------------------------------
+#include "ControllerConnection.h"
+
+
+//-----------------------------------------------------------------------------
+ControllerConnectionManager::ControllerConnectionManager() :
+    myProbeAll( false ),
+    myProbes( 0 ),
+    myDeviceChanged( true )   // probe everything on the first sample
+{
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        myConnected[i] = false;
+        myBackoffMs[i] = PROBE_BACKOFF_MIN_MS;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: shouldPoll()
+// Desc: Connected slots always; empty slots when their backoff ran out or a
+//       device change was reported
+//-----------------------------------------------------------------------------
+bool ControllerConnectionManager::shouldPoll( int i, const ArTime &now )
+{
+    // Latch the device change once per sample, at the first slot
+    if( i == 0 )
+        myProbeAll = myDeviceChanged.exchange( false );
+
+    if( myConnected[i] )
+        return true;
+
+    if( myProbeAll || !now.isBefore( myNextProbe[i] ) )
+    {
+        myProbes++;
+        return true;
+    }
+    return false;
+}
+
+
+//-----------------------------------------------------------------------------
+bool ControllerConnectionManager::reportPoll( int i, bool bConnected, const ArTime &now )
+{
+    if( bConnected == myConnected[i] )
+    {
+        if( !bConnected )
+        {
+            // Still empty; wait longer before the next try
+            myNextProbe[i] = now;
+            myNextProbe[i].addMSec( myBackoffMs[i] );
+            myBackoffMs[i] *= 2;
+            if( myBackoffMs[i] > PROBE_BACKOFF_MAX_MS )
+                myBackoffMs[i] = PROBE_BACKOFF_MAX_MS;
+        }
+        return false;
+    }
+
+    myConnected[i] = bConnected;
+
+    if( !bConnected )
+    {
+        // A pad that was just unplugged is likely to come back soon
+        myBackoffMs[i] = PROBE_BACKOFF_MIN_MS;
+        myNextProbe[i] = now;
+        myNextProbe[i].addMSec( myBackoffMs[i] );
+    }
+    return true;
+}
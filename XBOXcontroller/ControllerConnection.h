@@ -0,0 +1,51 @@
+//-----------------------------------------------------------------------------
+// File: ControllerConnection.h
+//
+// Decides which XInput slots GamepadXInput reads.  XInputGetState on an
+// empty slot is expensive, so connected slots are read every sample and
+// empty ones are only probed on an exponential backoff, or right away when
+// Windows reports that a device arrived.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "Gamepad.h"
+#include "Aria.h"
+#include <atomic>
+
+#define PROBE_BACKOFF_MIN_MS   100    // first re-probe of an empty slot
+#define PROBE_BACKOFF_MAX_MS  2000    // backoff stops growing here
+
+class ControllerConnectionManager
+{
+public:
+    ControllerConnectionManager();
+
+    //-------------------------------------------------------------------------
+    // Input thread only
+    //-------------------------------------------------------------------------
+
+    // Should slot i be read in this sample?
+    bool shouldPoll( int i, const ArTime &now );
+    // Result of reading slot i; true if the slot connected or disconnected
+    bool reportPoll( int i, bool bConnected, const ArTime &now );
+
+    // Probes of empty slots so far
+    unsigned int getProbes() const { return myProbes; }
+
+    //-------------------------------------------------------------------------
+    // Any thread
+    //-------------------------------------------------------------------------
+
+    // Probe every empty slot on the next sample (WM_DEVICECHANGE)
+    void deviceChanged() { myDeviceChanged.store( true ); }
+
+    bool isConnected( int i ) const { return myConnected[i].load(); }
+
+protected:
+    std::atomic<bool> myConnected[MAX_CONTROLLERS];
+    ArTime myNextProbe[MAX_CONTROLLERS];
+    unsigned int myBackoffMs[MAX_CONTROLLERS];
+    bool myProbeAll;
+    unsigned int myProbes;
+    std::atomic<bool> myDeviceChanged;
+};
@@ -0,0 +1,196 @@
+//-----------------------------------------------------------------------------
+// File: ControllerInput.cpp
+//
+// Fixed-rate gamepad sampling thread
+//-----------------------------------------------------------------------------
+#include "ControllerInput.h"
+#include <string.h>
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib,"winmm.lib")
+#endif
+
+
+//-----------------------------------------------------------------------------
+ControllerInputThread::ControllerInputThread( GamepadSource *source, unsigned int rateHz ) :
+    myPeriodMs( rateHz > 0 ? 1000 / rateHz : 1000 / INPUT_RATE_HZ ),
+    mySequence( 0 ),
+    myOverruns( 0 ),
+    myUnchangedSamples( 0 ),
+    mySource( source ),
+    myLastDeadZoneOn( false ),
+    myShapingGeneration( 0 ),
+    myDeadZoneOn( true ),
+    myDisplayNotifyCB( nullptr ),
+    myDisplayPosted( false ),
+    myDriveSlotCount( 0 )
+{
+    if( myPeriodMs == 0 )
+        myPeriodMs = 1;
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        myLastPacket[i] = 0;
+        myLastConnected[i] = false;
+    }
+    memset( &myLastAxes, 0, sizeof( myLastAxes ) );
+    setThreadName( "ControllerInputThread" );
+}
+
+
+//-----------------------------------------------------------------------------
+ControllerInputThread::~ControllerInputThread()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: sample()
+// Desc: Read all the gamepad slots once, then shape the sticks and triggers
+//       of all four pads together.  Returns false if no controller changed
+//       since the previous sample, in which case the last shaped axes are
+//       reused.
+//-----------------------------------------------------------------------------
+bool ControllerInputThread::sample( CONTROLLER_SNAPSHOT *snapshot )
+{
+    CONTROLLER_AXES &axes = snapshot->axes;
+    bool bChanged = false;
+
+    mySource->read( snapshot->pads );
+
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        const GAMEPAD_STATE &pad = snapshot->pads[i];
+
+        // Every backend bumps uPacket whenever anything on the pad changes
+        if( pad.bConnected != myLastConnected[i] || pad.uPacket != myLastPacket[i] )
+        {
+            myLastConnected[i] = pad.bConnected;
+            myLastPacket[i] = pad.uPacket;
+            bChanged = true;
+        }
+    }
+
+    bool bDeadZoneOn = myDeadZoneOn.load();
+    if( bDeadZoneOn != myLastDeadZoneOn || mySequence == 0 )
+    {
+        myLastDeadZoneOn = bDeadZoneOn;
+        myShaping.fStickDeadZone = bDeadZoneOn ? INPUT_DEADZONE : 0.0f;
+        myShaping.fTriggerThreshold = bDeadZoneOn ? float( GAMEPAD_TRIGGER_THRESHOLD ) : 0.0f;
+        myShapingGeneration++;
+        bChanged = true;
+    }
+    snapshot->uShapingGeneration = myShapingGeneration;
+
+    if( bChanged )
+    {
+        for( int i = 0; i < MAX_CONTROLLERS; i++ )
+        {
+            const GAMEPAD_STATE &gamepad = snapshot->pads[i];
+            axes.fThumbLX[i] = gamepad.sThumbLX;
+            axes.fThumbLY[i] = gamepad.sThumbLY;
+            axes.fThumbRX[i] = gamepad.sThumbRX;
+            axes.fThumbRY[i] = gamepad.sThumbRY;
+            axes.fLeftTrigger[i] = gamepad.bLeftTrigger;
+            axes.fRightTrigger[i] = gamepad.bRightTrigger;
+        }
+        ShapeControllerAxes( &axes, myShaping );
+        myLastAxes = axes;
+    }
+    else
+    {
+        axes = myLastAxes;
+        myUnchangedSamples++;
+    }
+
+    // Keep showing zero for a stick inside the dead zone
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        GAMEPAD_STATE &gamepad = snapshot->pads[i];
+        if( axes.fThumbLX[i] == 0 && axes.fThumbLY[i] == 0 )
+        {
+            gamepad.sThumbLX = 0;
+            gamepad.sThumbLY = 0;
+        }
+        if( axes.fThumbRX[i] == 0 && axes.fThumbRY[i] == 0 )
+        {
+            gamepad.sThumbRX = 0;
+            gamepad.sThumbRY = 0;
+        }
+    }
+
+    snapshot->uSequence = ++mySequence;
+    return bChanged;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: runThread()
+// Desc: Sample on a fixed schedule.  Deadlines are absolute so a slow sample
+//       does not shift every later one.  Input that an event-driven source
+//       reports between deadlines is sampled right away, without moving the
+//       schedule.
+//-----------------------------------------------------------------------------
+void *ControllerInputThread::runThread( void * )
+{
+#ifdef WIN32
+    // Sleep() granularity is 15.6 ms by default, which is far too coarse for
+    // a 4 ms period
+    timeBeginPeriod( 1 );
+#endif
+
+    threadStarted();
+
+    if( !mySource->open() )
+        ArLog::log( ArLog::Terse, "ControllerInputThread: could not open %s gamepads", mySource->getName() );
+
+    ArTime nextSample;
+    while( getRunning() )
+    {
+        // The drive threads get every sample, changed or not, since that is
+        // what keeps the command schedulers' deadlines alive
+        CONTROLLER_SNAPSHOT *snapshot = myDriveSlots[0].beginWrite();
+        bool bChanged = sample( snapshot );
+        if( bChanged )
+            myDisplaySlot.publish( *snapshot );
+        for( int d = 1; d < myDriveSlotCount; d++ )
+            myDriveSlots[d].publish( *snapshot );
+        myDriveSlots[0].publish();
+
+        // Only one notification in flight; the window always reads the
+        // newest snapshot when it gets to it
+        ArRetFunctor<bool> *notifyCB = myDisplayNotifyCB.load();
+        if( bChanged && notifyCB != nullptr && !myDisplayPosted.exchange( true ) )
+        {
+            if( !notifyCB->invokeR() )
+                myDisplayPosted.store( false );
+        }
+
+        long wait = nextSample.mSecTo();
+        if( wait <= 0 )
+        {
+            // This was the scheduled sample; set up the next one
+            nextSample.addMSec( myPeriodMs );
+            wait = nextSample.mSecTo();
+            if( wait <= 0 )
+            {
+                myOverruns++;
+                // Fell more than a period behind, so resynchronize instead
+                // of bursting to catch up
+                if( wait < -(long)myPeriodMs )
+                    nextSample.setToNow();
+                continue;
+            }
+        }
+        mySource->waitForInput( int( wait ) );
+    }
+
+#ifdef WIN32
+    timeEndPeriod( 1 );
+#endif
+
+    threadFinished();
+    return nullptr;
+}
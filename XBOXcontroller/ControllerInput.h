@@ -0,0 +1,95 @@
+//-----------------------------------------------------------------------------
+// File: ControllerInput.h
+//
+// Fixed-rate gamepad sampling thread.  It owns the GamepadSource and hands
+// every sample to the drive logic and to the display through lock-free
+// slots, so neither the message pump nor the painting code can delay teleop.
+// Event-driven sources also wake it early, so new input is sampled as soon as
+// it arrives rather than at the next tick.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "Gamepad.h"
+#include "DeadzoneKernel.h"
+#include "LatestValueSlot.h"
+#include "Aria.h"
+#include <atomic>
+
+#define INPUT_DEADZONE  ( 0.24f * 32767.0f )  // Default to 24% of the +/- 32767 range.   This is a reasonable default value but can be altered if needed.
+#define INPUT_RATE_HZ   250                   // How often the input thread samples the gamepads
+
+// Everything the input thread learned in one sampling pass
+struct CONTROLLER_SNAPSHOT
+{
+    GAMEPAD_STATE pads[MAX_CONTROLLERS];
+    CONTROLLER_AXES axes;     // shaped sticks and triggers, one lane per pad
+    unsigned int uSequence;   // incremented once per sample
+    unsigned int uShapingGeneration;   // changes when the same raw input would shape differently
+};
+static_assert( MAX_CONTROLLERS == AXES_LANES, "one dead zone kernel lane per controller" );
+
+class ControllerInputThread : public ArASyncTask
+{
+public:
+    ControllerInputThread( GamepadSource *source, unsigned int rateHz = INPUT_RATE_HZ );
+    virtual ~ControllerInputThread();
+
+    virtual void *runThread( void *arg );
+
+    // One slot per drive thread, each gets every sample.  Up to
+    // MAX_CONTROLLERS, before runAsync(); nullptr when they are used up.
+    LatestValueSlot<CONTROLLER_SNAPSHOT> *addDriveSlot()
+    { return myDriveSlotCount < MAX_CONTROLLERS ? &myDriveSlots[myDriveSlotCount++] : nullptr; }
+    // Consumed by the display after the notify callback fires
+    LatestValueSlot<CONTROLLER_SNAPSHOT> *getDisplaySlot() { return &myDisplaySlot; }
+
+    // Called on the input thread when the display slot has something new
+    // and the previous notification was consumed; returns false if the
+    // notification could not be delivered.  nullptr for none.
+    void setDisplayNotifyCB( ArRetFunctor<bool> *functor ) { myDisplayNotifyCB.store( functor ); }
+    // Called by the display after it drained the display slot so the next
+    // sample notifies again
+    void displayConsumed() { myDisplayPosted.store( false ); }
+
+    // Where samples come from; switch only before runAsync()
+    void setSource( GamepadSource *source ) { mySource = source; }
+    GamepadSource *getSource() { return mySource; }
+
+    // Any thread; takes effect on the next sample
+    void setDeadZone( bool bOn ) { myDeadZoneOn.store( bOn ); }
+    bool getDeadZone() const { return myDeadZoneOn.load(); }
+
+    // Response curve for sticks; configure before runAsync()
+    void setCurve( RESPONSE_CURVE curve, float expo ) { myShaping.eCurve = curve; myShaping.fExpo = expo; }
+
+    unsigned int getPeriodMs() const { return myPeriodMs; }
+    // Number of samples that started later than their deadline
+    unsigned int getOverruns() const { return myOverruns; }
+    // Samples in which no controller changed, and samples in total
+    unsigned int getUnchangedSamples() const { return myUnchangedSamples; }
+    unsigned int getSamples() const { return mySequence; }
+
+protected:
+    bool sample( CONTROLLER_SNAPSHOT *snapshot );
+
+    unsigned int myPeriodMs;
+    unsigned int mySequence;
+    unsigned int myOverruns;
+    unsigned int myUnchangedSamples;
+
+    GamepadSource *mySource;
+
+    // What the previous sample saw, to tell whether anything changed
+    unsigned int myLastPacket[MAX_CONTROLLERS];
+    bool myLastConnected[MAX_CONTROLLERS];
+    bool myLastDeadZoneOn;
+    unsigned int myShapingGeneration;
+    CONTROLLER_AXES myLastAxes;
+    AXIS_SHAPING myShaping;
+    std::atomic<bool> myDeadZoneOn;
+    std::atomic<ArRetFunctor<bool> *> myDisplayNotifyCB;
+    std::atomic<bool> myDisplayPosted;
+    LatestValueSlot<CONTROLLER_SNAPSHOT> myDriveSlots[MAX_CONTROLLERS];
+    int myDriveSlotCount;
+    LatestValueSlot<CONTROLLER_SNAPSHOT> myDisplaySlot;
+};
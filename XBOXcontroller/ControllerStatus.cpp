@@ -0,0 +1,154 @@
+//-----------------------------------------------------------------------------
+// File: ControllerStatus.cpp
+//
+// Per-field controller status text
+//-----------------------------------------------------------------------------
+#include "ControllerStatus.h"
+
+
+//-----------------------------------------------------------------------------
+// Button names in the order they are listed
+//-----------------------------------------------------------------------------
+static const struct
+{
+    unsigned short wButton;
+    const wchar_t *szName;
+} BUTTON_NAMES[] =
+{
+    { GAMEPAD_DPAD_UP,        L"DPAD_UP " },
+    { GAMEPAD_DPAD_DOWN,      L"DPAD_DOWN " },
+    { GAMEPAD_DPAD_LEFT,      L"DPAD_LEFT " },
+    { GAMEPAD_DPAD_RIGHT,     L"DPAD_RIGHT " },
+    { GAMEPAD_START,          L"START " },
+    { GAMEPAD_BACK,           L"BACK " },
+    { GAMEPAD_LEFT_THUMB,     L"LEFT_THUMB " },
+    { GAMEPAD_RIGHT_THUMB,    L"RIGHT_THUMB " },
+    { GAMEPAD_LEFT_SHOULDER,  L"LEFT_SHOULDER " },
+    { GAMEPAD_RIGHT_SHOULDER, L"RIGHT_SHOULDER " },
+    { GAMEPAD_A,              L"A " },
+    { GAMEPAD_B,              L"B " },
+    { GAMEPAD_X,              L"X " },
+    { GAMEPAD_Y,              L"Y " },
+};
+
+
+//-----------------------------------------------------------------------------
+// Name: Append() / AppendInt()
+// Desc: Append to a field, never past STATUS_FIELD_CHARS.  These replace
+//       swprintf, which is most of the cost of a line this short.
+//-----------------------------------------------------------------------------
+static wchar_t *Append( wchar_t *p, wchar_t *end, const wchar_t *text )
+{
+    while( *text && p < end )
+        *p++ = *text++;
+    return p;
+}
+
+
+static wchar_t *AppendInt( wchar_t *p, wchar_t *end, int value )
+{
+    wchar_t digits[12];
+    int n = 0;
+    unsigned int u = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    do
+    {
+        digits[n++] = wchar_t( L'0' + u % 10 );
+        u /= 10;
+    } while( u != 0 );
+    if( value < 0 && p < end )
+        *p++ = L'-';
+    while( n > 0 && p < end )
+        *p++ = digits[--n];
+    return p;
+}
+
+
+//-----------------------------------------------------------------------------
+static void FormatField( wchar_t *field, int slot, STATUS_FIELD which, const GAMEPAD_STATE &pad )
+{
+    wchar_t *p = field;
+    wchar_t *end = field + STATUS_FIELD_CHARS - 1;
+
+    switch( which )
+    {
+        case STATUS_CONNECTED:
+            p = Append( p, end, L"Controller " );
+            p = AppendInt( p, end, slot );
+            p = Append( p, end, pad.bConnected ? L": Connected" : L": Not connected" );
+            break;
+        case STATUS_BUTTONS:
+            p = Append( p, end, L"  Pressed Buttons: " );
+            for( int i = 0; i < int( sizeof( BUTTON_NAMES ) / sizeof( BUTTON_NAMES[0] ) ); i++ )
+            {
+                if( pad.wButtons & BUTTON_NAMES[i].wButton )
+                    p = Append( p, end, BUTTON_NAMES[i].szName );
+            }
+            break;
+        case STATUS_LEFT_TRIGGER:
+            p = Append( p, end, L"  Left Trigger: " );
+            p = AppendInt( p, end, pad.bLeftTrigger );
+            break;
+        case STATUS_RIGHT_TRIGGER:
+            p = Append( p, end, L"  Right Trigger: " );
+            p = AppendInt( p, end, pad.bRightTrigger );
+            break;
+        case STATUS_LEFT_THUMB:
+            p = Append( p, end, L"  Left Thumbstick: " );
+            p = AppendInt( p, end, pad.sThumbLX );
+            p = Append( p, end, L"/" );
+            p = AppendInt( p, end, pad.sThumbLY );
+            break;
+        case STATUS_RIGHT_THUMB:
+            p = Append( p, end, L"  Right Thumbstick: " );
+            p = AppendInt( p, end, pad.sThumbRX );
+            p = Append( p, end, L"/" );
+            p = AppendInt( p, end, pad.sThumbRY );
+            break;
+        default:
+            break;
+    }
+    *p = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: UpdateControllerStatus()
+// Desc: Compare the raw values first; only fields whose values differ from
+//       what is shown get formatted
+//-----------------------------------------------------------------------------
+unsigned int UpdateControllerStatus( CONTROLLER_STATUS *status, int slot, const GAMEPAD_STATE &pad )
+{
+    const GAMEPAD_STATE &shown = status->shown;
+    bool bAll = !status->bValid || pad.bConnected != shown.bConnected;
+    unsigned int changed = 0;
+
+    if( bAll )
+        changed = ( 1u << STATUS_FIELDS ) - 1;
+    else if( pad.bConnected )
+    {
+        if( pad.wButtons != shown.wButtons )
+            changed |= 1u << STATUS_BUTTONS;
+        if( pad.bLeftTrigger != shown.bLeftTrigger )
+            changed |= 1u << STATUS_LEFT_TRIGGER;
+        if( pad.bRightTrigger != shown.bRightTrigger )
+            changed |= 1u << STATUS_RIGHT_TRIGGER;
+        if( pad.sThumbLX != shown.sThumbLX || pad.sThumbLY != shown.sThumbLY )
+            changed |= 1u << STATUS_LEFT_THUMB;
+        if( pad.sThumbRX != shown.sThumbRX || pad.sThumbRY != shown.sThumbRY )
+            changed |= 1u << STATUS_RIGHT_THUMB;
+    }
+
+    for( int i = 0; i < STATUS_FIELDS; i++ )
+    {
+        if( !( changed & ( 1u << i ) ) )
+            continue;
+        if( pad.bConnected || i == STATUS_CONNECTED )
+            FormatField( status->szField[i], slot, STATUS_FIELD( i ), pad );
+        else
+            status->szField[i][0] = 0;
+    }
+
+    status->shown = pad;
+    status->bValid = true;
+    return changed;
+}
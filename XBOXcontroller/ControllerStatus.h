@@ -0,0 +1,42 @@
+//-----------------------------------------------------------------------------
+// File: ControllerStatus.h
+//
+// What the window shows for one controller, one line per field.  Each field
+// keeps the values its text was made from, so a new sample only formats the
+// fields that actually changed and the window only repaints their lines.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "Gamepad.h"
+#include <wchar.h>
+
+enum STATUS_FIELD
+{
+    STATUS_CONNECTED,       // "Controller n: Connected"
+    STATUS_BUTTONS,
+    STATUS_LEFT_TRIGGER,
+    STATUS_RIGHT_TRIGGER,
+    STATUS_LEFT_THUMB,
+    STATUS_RIGHT_THUMB,
+    STATUS_FIELDS
+};
+
+#define STATUS_FIELD_CHARS 160  // the longest line is every button held down
+
+struct CONTROLLER_STATUS
+{
+    bool bValid;                // false until the first update
+    GAMEPAD_STATE shown;        // values the text was made from
+    wchar_t szField[STATUS_FIELDS][STATUS_FIELD_CHARS];
+
+    CONTROLLER_STATUS() : bValid( false )
+    {
+        for( int i = 0; i < STATUS_FIELDS; i++ )
+            szField[i][0] = 0;
+    }
+};
+
+// Bring status up to date with pad; returns a mask of ( 1 << STATUS_FIELD )
+// for the fields whose text changed.  A disconnected pad shows only
+// STATUS_CONNECTED; the other fields are empty.
+unsigned int UpdateControllerStatus( CONTROLLER_STATUS *status, int slot, const GAMEPAD_STATE &pad );
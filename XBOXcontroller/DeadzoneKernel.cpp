@@ -0,0 +1,166 @@
+//-----------------------------------------------------------------------------
+// File: DeadzoneKernel.cpp
+//
+// Batched dead zone, rescaling and response curve
+//
+// Sticks use a radial (circular) dead zone: the stick is zeroed when its
+// distance from center is inside the dead zone, otherwise the distance past
+// the dead zone is rescaled to [0, 1], run through the curve and applied
+// along the original direction.  Every curve is written as a*n + b*n^3.
+//-----------------------------------------------------------------------------
+#include "DeadzoneKernel.h"
+#include <math.h>
+#include <string.h>
+
+#ifdef DEADZONE_KERNEL_SSE2
+#include <emmintrin.h>
+#endif
+
+#define STICK_MAX   32767.0f
+#define TRIGGER_MAX 255.0f
+
+
+//-----------------------------------------------------------------------------
+// Name: CurveCoefficients()
+// Desc: a and b for a*n + b*n^3
+//-----------------------------------------------------------------------------
+static void CurveCoefficients( const AXIS_SHAPING &shaping, float *a, float *b )
+{
+    switch( shaping.eCurve )
+    {
+        case CURVE_LINEAR: *a = 1; *b = 0; break;
+        case CURVE_CUBIC:  *a = 0; *b = 1; break;
+        default:
+        {
+            float k = shaping.fExpo < 0 ? 0 : ( shaping.fExpo > 1 ? 1 : shaping.fExpo );
+            *a = 1 - k;
+            *b = k;
+            break;
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+static void ShapeStickScalar( float *xs, float *ys, float deadZone, float invRange, float a, float b )
+{
+    for( int i = 0; i < AXES_LANES; i++ )
+    {
+        float x = xs[i];
+        float y = ys[i];
+        float m = sqrtf( x * x + y * y );
+        if( m <= deadZone )
+        {
+            xs[i] = 0;
+            ys[i] = 0;
+            continue;
+        }
+        float n = ( m - deadZone ) * invRange;
+        if( n > 1 ) n = 1;
+        float scale = n * ( a + b * n * n ) / m;
+        xs[i] = x * scale;
+        ys[i] = y * scale;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+static void ShapeTriggerScalar( float *ts, float threshold, float invRange )
+{
+    for( int i = 0; i < AXES_LANES; i++ )
+    {
+        float t = ( ts[i] - threshold ) * invRange;
+        ts[i] = t < 0 ? 0 : ( t > 1 ? 1 : t );
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+void ShapeControllerAxesScalar( CONTROLLER_AXES *axes, const AXIS_SHAPING &shaping )
+{
+    float a, b;
+    CurveCoefficients( shaping, &a, &b );
+
+    float stickInvRange = 1.0f / ( STICK_MAX - shaping.fStickDeadZone );
+    ShapeStickScalar( axes->fThumbLX, axes->fThumbLY, shaping.fStickDeadZone, stickInvRange, a, b );
+    ShapeStickScalar( axes->fThumbRX, axes->fThumbRY, shaping.fStickDeadZone, stickInvRange, a, b );
+
+    float triggerInvRange = 1.0f / ( TRIGGER_MAX - shaping.fTriggerThreshold );
+    ShapeTriggerScalar( axes->fLeftTrigger, shaping.fTriggerThreshold, triggerInvRange );
+    ShapeTriggerScalar( axes->fRightTrigger, shaping.fTriggerThreshold, triggerInvRange );
+}
+
+
+#ifdef DEADZONE_KERNEL_SSE2
+//-----------------------------------------------------------------------------
+static void ShapeStickSSE2( float *xs, float *ys, __m128 deadZone, __m128 invRange, __m128 a, __m128 b )
+{
+    __m128 x = _mm_loadu_ps( xs );
+    __m128 y = _mm_loadu_ps( ys );
+    __m128 m = _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ) );
+
+    // Lanes inside the dead zone (including m == 0, which would divide by
+    // zero below) end up masked to 0
+    __m128 active = _mm_cmpgt_ps( m, deadZone );
+
+    __m128 n = _mm_min_ps( _mm_mul_ps( _mm_sub_ps( m, deadZone ), invRange ), _mm_set1_ps( 1.0f ) );
+    __m128 curve = _mm_mul_ps( n, _mm_add_ps( a, _mm_mul_ps( b, _mm_mul_ps( n, n ) ) ) );
+    __m128 scale = _mm_and_ps( active, _mm_div_ps( curve, m ) );
+
+    _mm_storeu_ps( xs, _mm_mul_ps( x, scale ) );
+    _mm_storeu_ps( ys, _mm_mul_ps( y, scale ) );
+}
+
+
+//-----------------------------------------------------------------------------
+static void ShapeTriggerSSE2( float *ts, __m128 threshold, __m128 invRange )
+{
+    __m128 t = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( ts ), threshold ), invRange );
+    t = _mm_min_ps( _mm_max_ps( t, _mm_setzero_ps() ), _mm_set1_ps( 1.0f ) );
+    _mm_storeu_ps( ts, t );
+}
+
+
+//-----------------------------------------------------------------------------
+void ShapeControllerAxesSSE2( CONTROLLER_AXES *axes, const AXIS_SHAPING &shaping )
+{
+    float a, b;
+    CurveCoefficients( shaping, &a, &b );
+
+    __m128 deadZone = _mm_set1_ps( shaping.fStickDeadZone );
+    __m128 stickInvRange = _mm_set1_ps( 1.0f / ( STICK_MAX - shaping.fStickDeadZone ) );
+    __m128 va = _mm_set1_ps( a );
+    __m128 vb = _mm_set1_ps( b );
+    ShapeStickSSE2( axes->fThumbLX, axes->fThumbLY, deadZone, stickInvRange, va, vb );
+    ShapeStickSSE2( axes->fThumbRX, axes->fThumbRY, deadZone, stickInvRange, va, vb );
+
+    __m128 threshold = _mm_set1_ps( shaping.fTriggerThreshold );
+    __m128 triggerInvRange = _mm_set1_ps( 1.0f / ( TRIGGER_MAX - shaping.fTriggerThreshold ) );
+    ShapeTriggerSSE2( axes->fLeftTrigger, threshold, triggerInvRange );
+    ShapeTriggerSSE2( axes->fRightTrigger, threshold, triggerInvRange );
+}
+#endif
+
+
+//-----------------------------------------------------------------------------
+void ShapeControllerAxes( CONTROLLER_AXES *axes, const AXIS_SHAPING &shaping )
+{
+#ifdef DEADZONE_KERNEL_SSE2
+    ShapeControllerAxesSSE2( axes, shaping );
+#else
+    ShapeControllerAxesScalar( axes, shaping );
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+bool ParseResponseCurve( const char *name, RESPONSE_CURVE *curve )
+{
+    if( name == nullptr )
+        return false;
+    if( strcmp( name, "linear" ) == 0 )     *curve = CURVE_LINEAR;
+    else if( strcmp( name, "expo" ) == 0 )  *curve = CURVE_EXPO;
+    else if( strcmp( name, "cubic" ) == 0 ) *curve = CURVE_CUBIC;
+    else return false;
+    return true;
+}
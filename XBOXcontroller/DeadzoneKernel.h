@@ -0,0 +1,51 @@
+//-----------------------------------------------------------------------------
+// File: DeadzoneKernel.h
+//
+// Dead zone, rescaling and response curve for the sticks and triggers of all
+// four controllers in one pass.  The axes are kept structure-of-arrays so one
+// SSE register holds the same axis for the four controller slots.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#define AXES_LANES 4    // one lane per XInput slot
+
+enum RESPONSE_CURVE
+{
+    CURVE_LINEAR,
+    CURVE_EXPO,     // (1-k)*x + k*x^3
+    CURVE_CUBIC
+};
+
+// Raw XInput values in, shaped values out: sticks in [-1, 1] with the
+// direction preserved, triggers in [0, 1]
+struct CONTROLLER_AXES
+{
+    float fThumbLX[AXES_LANES];
+    float fThumbLY[AXES_LANES];
+    float fThumbRX[AXES_LANES];
+    float fThumbRY[AXES_LANES];
+    float fLeftTrigger[AXES_LANES];
+    float fRightTrigger[AXES_LANES];
+};
+
+struct AXIS_SHAPING
+{
+    float fStickDeadZone;      // radius in raw stick units, 0 to disable
+    float fTriggerThreshold;   // raw trigger units, 0 to disable
+    RESPONSE_CURVE eCurve;
+    float fExpo;               // blend for CURVE_EXPO
+
+    AXIS_SHAPING() : fStickDeadZone( 0 ), fTriggerThreshold( 0 ), eCurve( CURVE_LINEAR ), fExpo( 0.6f ) {}
+};
+
+// Picks the SSE2 kernel when the build targets SSE2, otherwise the scalar one
+void ShapeControllerAxes( CONTROLLER_AXES *axes, const AXIS_SHAPING &shaping );
+
+void ShapeControllerAxesScalar( CONTROLLER_AXES *axes, const AXIS_SHAPING &shaping );
+#if defined(_M_X64) || defined(_M_AMD64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 ) || defined(__SSE2__)
+#define DEADZONE_KERNEL_SSE2
+void ShapeControllerAxesSSE2( CONTROLLER_AXES *axes, const AXIS_SHAPING &shaping );
+#endif
+
+// Parse "linear", "expo" or "cubic"; returns false if not recognized
+bool ParseResponseCurve( const char *name, RESPONSE_CURVE *curve );
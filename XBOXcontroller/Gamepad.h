@@ -0,0 +1,94 @@
+//-----------------------------------------------------------------------------
+// File: Gamepad.h
+//
+// Platform-neutral gamepad state and the interface every input backend
+// implements.  The state uses the XInput conventions (button bits, stick
+// range and direction, 0-255 triggers) so the XInput backend is a copy and
+// the other backends convert into it.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "Aria.h"
+#include <list>
+
+#define MAX_CONTROLLERS 4     // XInput handles up to 4 controllers; other backends follow
+
+// Same values as XINPUT_GAMEPAD_*
+enum GAMEPAD_BUTTON
+{
+    GAMEPAD_DPAD_UP        = 0x0001,
+    GAMEPAD_DPAD_DOWN      = 0x0002,
+    GAMEPAD_DPAD_LEFT      = 0x0004,
+    GAMEPAD_DPAD_RIGHT     = 0x0008,
+    GAMEPAD_START          = 0x0010,
+    GAMEPAD_BACK           = 0x0020,
+    GAMEPAD_LEFT_THUMB     = 0x0040,
+    GAMEPAD_RIGHT_THUMB    = 0x0080,
+    GAMEPAD_LEFT_SHOULDER  = 0x0100,
+    GAMEPAD_RIGHT_SHOULDER = 0x0200,
+    GAMEPAD_A              = 0x1000,
+    GAMEPAD_B              = 0x2000,
+    GAMEPAD_X              = 0x4000,
+    GAMEPAD_Y              = 0x8000
+};
+
+#define GAMEPAD_TRIGGER_THRESHOLD 30    // same as XINPUT_GAMEPAD_TRIGGER_THRESHOLD
+
+struct GAMEPAD_STATE
+{
+    unsigned int   uPacket;         // changes whenever anything on the pad changes
+    unsigned short wButtons;        // GAMEPAD_BUTTON bits
+    unsigned char  bLeftTrigger;    // 0 - 255
+    unsigned char  bRightTrigger;
+    short          sThumbLX;        // -32768 - 32767, right is positive
+    short          sThumbLY;        // up is positive
+    short          sThumbRX;
+    short          sThumbRY;
+    bool           bConnected;
+    long long      llTimeUs;        // MonotonicMicros() of the input, from the event where the backend has one
+};
+
+class GamepadSource
+{
+public:
+    virtual ~GamepadSource() {}
+
+    virtual const char *getName() const = 0;
+
+    // Get ready to read; false if the backend cannot work at all
+    virtual bool open() { return true; }
+
+    // Current state of every slot.  Never blocks.
+    virtual void read( GAMEPAD_STATE pads[MAX_CONTROLLERS] ) = 0;
+
+    // Wait up to timeoutMs for new input.  Backends that can only poll just
+    // sleep and return false; event-driven ones return true as soon as an
+    // event arrives.
+    virtual bool waitForInput( int timeoutMs ) { ArUtil::sleep( timeoutMs ); return false; }
+
+    // Hint from the platform that a device was added or removed
+    virtual void deviceChanged() {}
+
+    // Vibration, 0 - 65535 for the low-frequency (left) and high-frequency
+    // (right) motor.  Any thread, but it may block briefly, so keep it off
+    // the input thread.  False if the slot cannot rumble.
+    virtual bool setRumble( int, unsigned short, unsigned short ) { return false; }
+
+    // Called on the reading thread with the slot number.  Add these before
+    // reading starts and keep them short.
+    void addConnectCB( ArFunctor1<int> *functor ) { myConnectCBs.push_back( functor ); }
+    void addDisconnectCB( ArFunctor1<int> *functor ) { myDisconnectCBs.push_back( functor ); }
+    void remConnectCB( ArFunctor1<int> *functor ) { myConnectCBs.remove( functor ); }
+    void remDisconnectCB( ArFunctor1<int> *functor ) { myDisconnectCBs.remove( functor ); }
+
+protected:
+    void notifyConnection( int slot, bool bConnected )
+    {
+        std::list<ArFunctor1<int> *> &cbs = bConnected ? myConnectCBs : myDisconnectCBs;
+        for( std::list<ArFunctor1<int> *>::iterator it = cbs.begin(); it != cbs.end(); ++it )
+            ( *it )->invoke( slot );
+    }
+
+    std::list<ArFunctor1<int> *> myConnectCBs;
+    std::list<ArFunctor1<int> *> myDisconnectCBs;
+};
@@ -0,0 +1,578 @@
+//-----------------------------------------------------------------------------
+// File: GamepadEvdev.cpp
+//
+// Linux evdev backend for GamepadSource
+//
+// Devices are mapped following the kernel's gamepad layout
+// (Documentation/input/gamepad.rst): left stick ABS_X/ABS_Y, right stick
+// ABS_RX/ABS_RY, analog triggers ABS_Z/ABS_RZ, D-pad on ABS_HAT0X/ABS_HAT0Y
+// or BTN_DPAD_*.  Values are converted to the XInput ranges and directions.
+//-----------------------------------------------------------------------------
+#include "GamepadEvdev.h"
+#include "HighResClock.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+// Older headers only have the timeval member
+#ifndef input_event_sec
+#define input_event_sec  time.tv_sec
+#define input_event_usec time.tv_usec
+#endif
+
+#define INOTIFY_TAG MAX_CONTROLLERS   // epoll data for the inotify fd; pads use their slot
+#define RUMBLE_LENGTH_MS 500          // effects are refreshed well before they run out
+
+#define BITS_PER_LONG_ ( 8 * sizeof( unsigned long ) )
+#define NLONGS( n )    ( ( ( n ) + BITS_PER_LONG_ - 1 ) / BITS_PER_LONG_ )
+
+static bool TestBit( const unsigned long *bits, int bit )
+{
+    return ( bits[bit / BITS_PER_LONG_] >> ( bit % BITS_PER_LONG_ ) ) & 1;
+}
+
+static void WriteEvent( int fd, const struct input_event &ev )
+{
+    if( ::write( fd, &ev, sizeof( ev ) ) != (ssize_t)sizeof( ev ) )
+        ArLog::log( ArLog::Verbose, "GamepadEvdev: writing an event failed: %s", strerror( errno ) );
+}
+
+struct EVDEV_BUTTON
+{
+    int code;
+    unsigned short wButton;
+};
+
+static const EVDEV_BUTTON s_buttons[] =
+{
+    { BTN_SOUTH,      GAMEPAD_A },
+    { BTN_EAST,       GAMEPAD_B },
+    { BTN_NORTH,      GAMEPAD_Y },
+    { BTN_WEST,       GAMEPAD_X },
+    { BTN_TL,         GAMEPAD_LEFT_SHOULDER },
+    { BTN_TR,         GAMEPAD_RIGHT_SHOULDER },
+    { BTN_SELECT,     GAMEPAD_BACK },
+    { BTN_START,      GAMEPAD_START },
+    { BTN_THUMBL,     GAMEPAD_LEFT_THUMB },
+    { BTN_THUMBR,     GAMEPAD_RIGHT_THUMB },
+    { BTN_DPAD_UP,    GAMEPAD_DPAD_UP },
+    { BTN_DPAD_DOWN,  GAMEPAD_DPAD_DOWN },
+    { BTN_DPAD_LEFT,  GAMEPAD_DPAD_LEFT },
+    { BTN_DPAD_RIGHT, GAMEPAD_DPAD_RIGHT }
+};
+static const int s_numButtons = sizeof( s_buttons ) / sizeof( s_buttons[0] );
+
+static const int s_axes[] = { ABS_X, ABS_Y, ABS_RX, ABS_RY, ABS_Z, ABS_RZ, ABS_HAT0X, ABS_HAT0Y };
+static const int s_numAxes = sizeof( s_axes ) / sizeof( s_axes[0] );
+
+
+//-----------------------------------------------------------------------------
+// Name: ScaleStick()
+// Desc: [min, max] to the XInput -32768..32767.  evdev Y grows downwards
+//       and XInput Y upwards, so Y axes are flipped.
+//-----------------------------------------------------------------------------
+static short ScaleStick( int value, int iMin, int iMax, bool bFlip )
+{
+    if( iMax <= iMin )
+        return 0;
+    long long offset = (long long)( value - iMin ) * 65535 / ( iMax - iMin );
+    if( offset < 0 ) offset = 0;
+    if( offset > 65535 ) offset = 65535;
+    return short( bFlip ? 32767 - offset : offset - 32768 );
+}
+
+
+//-----------------------------------------------------------------------------
+static unsigned char ScaleTrigger( int value, int iMin, int iMax )
+{
+    if( iMax <= iMin )
+        return 0;
+    long long scaled = (long long)( value - iMin ) * 255 / ( iMax - iMin );
+    return (unsigned char)( scaled < 0 ? 0 : ( scaled > 255 ? 255 : scaled ) );
+}
+
+
+//-----------------------------------------------------------------------------
+GamepadEvdev::GamepadEvdev( const char *dir ) :
+    myEpoll( -1 ),
+    myInotify( -1 ),
+    myPacket( 0 ),
+    myRescan( true )
+{
+    snprintf( myDir, sizeof( myDir ), "%s", dir );
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        memset( &myPads[i], 0, sizeof( EVDEV_PAD ) );
+        myPads[i].fd = -1;
+        myRumbleCapable[i].store( false );
+        myRumble[i].store( 0 );
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+GamepadEvdev::~GamepadEvdev()
+{
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        if( myPads[i].fd >= 0 )
+            close( myPads[i].fd );
+    }
+    if( myInotify >= 0 )
+        close( myInotify );
+    if( myEpoll >= 0 )
+        close( myEpoll );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: open()
+// Desc: Set up epoll and the hotplug watch.  Devices are opened by the first
+//       read(), on the input thread, so the connect callbacks fire there.
+//-----------------------------------------------------------------------------
+bool GamepadEvdev::open()
+{
+    myEpoll = epoll_create1( EPOLL_CLOEXEC );
+    if( myEpoll < 0 )
+    {
+        ArLog::log( ArLog::Terse, "GamepadEvdev: epoll_create1 failed: %s", strerror( errno ) );
+        return false;
+    }
+
+    // udev creates the node first and fixes its permissions afterwards, so
+    // IN_ATTRIB is what tells us a new pad can actually be opened
+    myInotify = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if( myInotify >= 0 && inotify_add_watch( myInotify, myDir, IN_CREATE | IN_ATTRIB ) >= 0 )
+    {
+        struct epoll_event ev;
+        memset( &ev, 0, sizeof( ev ) );
+        ev.events = EPOLLIN;
+        ev.data.u32 = INOTIFY_TAG;
+        epoll_ctl( myEpoll, EPOLL_CTL_ADD, myInotify, &ev );
+    }
+    else
+    {
+        ArLog::log( ArLog::Normal, "GamepadEvdev: no hotplug notification for %s: %s", myDir, strerror( errno ) );
+    }
+
+    myRescan.store( true );
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: scan()
+// Desc: Open every gamepad in myDir that is not open yet, into free slots
+//-----------------------------------------------------------------------------
+void GamepadEvdev::scan()
+{
+    DIR *dir = opendir( myDir );
+    if( dir == nullptr )
+        return;
+
+    struct dirent *entry;
+    while( ( entry = readdir( dir ) ) != nullptr )
+    {
+        if( strncmp( entry->d_name, "event", 5 ) != 0 )
+            continue;
+
+        char path[64];
+        snprintf( path, sizeof( path ), "%s/%s", myDir, entry->d_name );
+
+        bool bOpen = false;
+        int freeSlot = -1;
+        for( int i = 0; i < MAX_CONTROLLERS; i++ )
+        {
+            if( myPads[i].fd >= 0 && strcmp( myPads[i].szPath, path ) == 0 )
+                bOpen = true;
+            else if( myPads[i].fd < 0 && freeSlot < 0 )
+                freeSlot = i;
+        }
+        if( bOpen )
+            continue;
+        if( freeSlot < 0 )
+            break;
+        openDevice( path );
+    }
+    closedir( dir );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: openDevice()
+// Desc: Open path if it is a gamepad and put it in the first free slot
+//-----------------------------------------------------------------------------
+bool GamepadEvdev::openDevice( const char *path )
+{
+    // Rumble needs write access, which udev does not always grant
+    bool bWritable = true;
+    int fd = ::open( path, O_RDWR | O_NONBLOCK | O_CLOEXEC );
+    if( fd < 0 )
+    {
+        bWritable = false;
+        fd = ::open( path, O_RDONLY | O_NONBLOCK | O_CLOEXEC );
+    }
+    if( fd < 0 )
+        return false;
+
+    unsigned long keyBits[NLONGS( KEY_CNT )];
+    unsigned long absBits[NLONGS( ABS_CNT )];
+    memset( keyBits, 0, sizeof( keyBits ) );
+    memset( absBits, 0, sizeof( absBits ) );
+    if( ioctl( fd, EVIOCGBIT( EV_KEY, sizeof( keyBits ) ), keyBits ) < 0 ||
+        ioctl( fd, EVIOCGBIT( EV_ABS, sizeof( absBits ) ), absBits ) < 0 ||
+        !TestBit( keyBits, BTN_GAMEPAD ) || !TestBit( absBits, ABS_X ) )
+    {
+        close( fd );
+        return false;
+    }
+
+    int slot = 0;
+    while( slot < MAX_CONTROLLERS && myPads[slot].fd >= 0 )
+        slot++;
+    if( slot == MAX_CONTROLLERS )
+    {
+        close( fd );
+        return false;
+    }
+
+    EVDEV_PAD &pad = myPads[slot];
+    memset( &pad, 0, sizeof( EVDEV_PAD ) );
+    pad.fd = fd;
+    // Event timestamps on the same clock as MonotonicMicros()
+    int clockId = CLOCK_MONOTONIC;
+    pad.bMonotonic = ( ioctl( fd, EVIOCSCLOCKID, &clockId ) >= 0 );
+    snprintf( pad.szPath, sizeof( pad.szPath ), "%s", path );
+    pad.bAnalogTriggers = TestBit( absBits, ABS_Z ) && TestBit( absBits, ABS_RZ );
+    unsigned long ffBits[NLONGS( FF_CNT )];
+    memset( ffBits, 0, sizeof( ffBits ) );
+    pad.bRumble = bWritable && ioctl( fd, EVIOCGBIT( EV_FF, sizeof( ffBits ) ), ffBits ) >= 0 &&
+                  TestBit( ffBits, FF_RUMBLE );
+    pad.iEffect = -1;
+    myRumbleCapable[slot].store( pad.bRumble );
+    for( int a = 0; a < s_numAxes; a++ )
+    {
+        struct input_absinfo info;
+        if( TestBit( absBits, s_axes[a] ) && ioctl( fd, EVIOCGABS( s_axes[a] ), &info ) >= 0 )
+        {
+            pad.ranges[s_axes[a]].iMin = info.minimum;
+            pad.ranges[s_axes[a]].iMax = info.maximum;
+        }
+    }
+
+    struct epoll_event ev;
+    memset( &ev, 0, sizeof( ev ) );
+    ev.events = EPOLLIN;
+    ev.data.u32 = slot;
+    if( epoll_ctl( myEpoll, EPOLL_CTL_ADD, fd, &ev ) < 0 )
+    {
+        close( fd );
+        pad.fd = -1;
+        return false;
+    }
+
+    char name[128] = "";
+    ioctl( fd, EVIOCGNAME( sizeof( name ) ), name );
+    ArLog::log( ArLog::Normal, "GamepadEvdev: %s (%s) in slot %d", path, name, slot );
+
+    resync( pad, MonotonicMicros() );
+    notifyConnection( slot, true );
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+void GamepadEvdev::closeSlot( int i )
+{
+    EVDEV_PAD &pad = myPads[i];
+    if( pad.fd < 0 )
+        return;
+    epoll_ctl( myEpoll, EPOLL_CTL_DEL, pad.fd, nullptr );
+    close( pad.fd );
+    pad.fd = -1;
+    myRumbleCapable[i].store( false );
+    memset( &pad.current, 0, sizeof( GAMEPAD_STATE ) );
+    pad.current.uPacket = ++myPacket;
+    pad.current.llTimeUs = MonotonicMicros();
+    notifyConnection( i, false );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: resync()
+// Desc: Rebuild the whole state from the device instead of from events.
+//       Used on open and after the kernel dropped events.
+//-----------------------------------------------------------------------------
+void GamepadEvdev::resync( EVDEV_PAD &pad, long long llTimeUs )
+{
+    memset( &pad.pending, 0, sizeof( GAMEPAD_STATE ) );
+    pad.wHatButtons = 0;
+
+    unsigned long keys[NLONGS( KEY_CNT )];
+    memset( keys, 0, sizeof( keys ) );
+    ioctl( pad.fd, EVIOCGKEY( sizeof( keys ) ), keys );
+    for( int b = 0; b < s_numButtons; b++ )
+    {
+        if( TestBit( keys, s_buttons[b].code ) )
+            pad.pending.wButtons |= s_buttons[b].wButton;
+    }
+    if( !pad.bAnalogTriggers )
+    {
+        pad.pending.bLeftTrigger = TestBit( keys, BTN_TL2 ) ? 255 : 0;
+        pad.pending.bRightTrigger = TestBit( keys, BTN_TR2 ) ? 255 : 0;
+    }
+
+    for( int a = 0; a < s_numAxes; a++ )
+    {
+        struct input_absinfo info;
+        if( pad.ranges[s_axes[a]].iMax > pad.ranges[s_axes[a]].iMin &&
+            ioctl( pad.fd, EVIOCGABS( s_axes[a] ), &info ) >= 0 )
+            handleAxis( pad, s_axes[a], info.value );
+    }
+
+    pad.bDropped = false;
+    commit( pad, llTimeUs );
+}
+
+
+//-----------------------------------------------------------------------------
+void GamepadEvdev::commit( EVDEV_PAD &pad, long long llTimeUs )
+{
+    pad.pending.bConnected = true;
+    pad.pending.uPacket = ++myPacket;
+    pad.pending.llTimeUs = llTimeUs;
+    pad.current = pad.pending;
+}
+
+
+//-----------------------------------------------------------------------------
+void GamepadEvdev::handleAxis( EVDEV_PAD &pad, int code, int value )
+{
+    const AXIS_RANGE &range = pad.ranges[code];
+    GAMEPAD_STATE &state = pad.pending;
+    switch( code )
+    {
+        case ABS_X:  state.sThumbLX = ScaleStick( value, range.iMin, range.iMax, false ); break;
+        case ABS_Y:  state.sThumbLY = ScaleStick( value, range.iMin, range.iMax, true );  break;
+        case ABS_RX: state.sThumbRX = ScaleStick( value, range.iMin, range.iMax, false ); break;
+        case ABS_RY: state.sThumbRY = ScaleStick( value, range.iMin, range.iMax, true );  break;
+        case ABS_Z:  state.bLeftTrigger = ScaleTrigger( value, range.iMin, range.iMax );  break;
+        case ABS_RZ: state.bRightTrigger = ScaleTrigger( value, range.iMin, range.iMax ); break;
+        case ABS_HAT0X:
+            pad.wHatButtons &= ~( GAMEPAD_DPAD_LEFT | GAMEPAD_DPAD_RIGHT );
+            if( value < 0 ) pad.wHatButtons |= GAMEPAD_DPAD_LEFT;
+            if( value > 0 ) pad.wHatButtons |= GAMEPAD_DPAD_RIGHT;
+            break;
+        case ABS_HAT0Y:
+            pad.wHatButtons &= ~( GAMEPAD_DPAD_UP | GAMEPAD_DPAD_DOWN );
+            if( value < 0 ) pad.wHatButtons |= GAMEPAD_DPAD_UP;
+            if( value > 0 ) pad.wHatButtons |= GAMEPAD_DPAD_DOWN;
+            break;
+        default:
+            return;
+    }
+    if( code == ABS_HAT0X || code == ABS_HAT0Y )
+    {
+        // The hat and BTN_DPAD_* share the D-pad bits
+        const unsigned short wDpad = GAMEPAD_DPAD_UP | GAMEPAD_DPAD_DOWN | GAMEPAD_DPAD_LEFT | GAMEPAD_DPAD_RIGHT;
+        state.wButtons = (unsigned short)( ( state.wButtons & ~wDpad ) | pad.wHatButtons );
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+void GamepadEvdev::handleEvent( EVDEV_PAD &pad, const struct input_event &ev )
+{
+    if( ev.type == EV_SYN )
+    {
+        if( ev.code == SYN_DROPPED )
+        {
+            pad.bDropped = true;
+        }
+        else if( ev.code == SYN_REPORT )
+        {
+            long long llTimeUs = pad.bMonotonic ?
+                (long long)ev.input_event_sec * 1000000 + ev.input_event_usec : MonotonicMicros();
+            if( pad.bDropped )
+                resync( pad, llTimeUs );
+            else
+                commit( pad, llTimeUs );
+        }
+        return;
+    }
+
+    // Everything up to the SYN_REPORT after a drop is incomplete
+    if( pad.bDropped )
+        return;
+
+    if( ev.type == EV_ABS && ev.code < ABS_CNT )
+    {
+        handleAxis( pad, ev.code, ev.value );
+    }
+    else if( ev.type == EV_KEY )
+    {
+        if( !pad.bAnalogTriggers && ( ev.code == BTN_TL2 || ev.code == BTN_TR2 ) )
+        {
+            ( ev.code == BTN_TL2 ? pad.pending.bLeftTrigger : pad.pending.bRightTrigger ) = ev.value ? 255 : 0;
+            return;
+        }
+        for( int b = 0; b < s_numButtons; b++ )
+        {
+            if( s_buttons[b].code != ev.code )
+                continue;
+            if( ev.value )
+                pad.pending.wButtons |= s_buttons[b].wButton;
+            else
+                pad.pending.wButtons &= ~s_buttons[b].wButton;
+            break;
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: drain()
+// Desc: Read everything queued on slot i without blocking
+//-----------------------------------------------------------------------------
+void GamepadEvdev::drain( int i )
+{
+    EVDEV_PAD &pad = myPads[i];
+    struct input_event events[64];
+    while( pad.fd >= 0 )
+    {
+        ssize_t n = ::read( pad.fd, events, sizeof( events ) );
+        if( n < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            if( errno != EAGAIN )
+                closeSlot( i );    // ENODEV once the pad is unplugged
+            return;
+        }
+        if( n == 0 )
+        {
+            closeSlot( i );
+            return;
+        }
+        int count = int( n / sizeof( struct input_event ) );
+        for( int e = 0; e < count; e++ )
+            handleEvent( pad, events[e] );
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: read()
+// Desc: Apply whatever the devices queued since the last call and report the
+//       last complete (SYN_REPORT terminated) state of every slot
+//-----------------------------------------------------------------------------
+void GamepadEvdev::read( GAMEPAD_STATE pads[MAX_CONTROLLERS] )
+{
+    if( myEpoll >= 0 && myRescan.exchange( false ) )
+        scan();
+
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        drain( i );
+        pads[i] = myPads[i].current;
+        if( myPads[i].bRumble )
+        {
+            unsigned int uRumble = myRumble[i].exchange( 0xFFFFFFFF );
+            if( uRumble != 0xFFFFFFFF )
+                applyRumble( myPads[i], uRumble );
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+bool GamepadEvdev::setRumble( int slot, unsigned short wLeft, unsigned short wRight )
+{
+    if( slot < 0 || slot >= MAX_CONTROLLERS || !myRumbleCapable[slot].load() )
+        return false;
+    myRumble[slot].store( ( (unsigned int)wLeft << 16 ) | wRight );
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: applyRumble()
+// Desc: Upload the strengths as an FF_RUMBLE effect (reusing its id) and
+//       play it, or stop it for zero
+//-----------------------------------------------------------------------------
+void GamepadEvdev::applyRumble( EVDEV_PAD &pad, unsigned int uRumble )
+{
+    struct input_event play;
+    memset( &play, 0, sizeof( play ) );
+    play.type = EV_FF;
+
+    if( uRumble == 0 )
+    {
+        if( pad.iEffect >= 0 && pad.uRumbleApplied != 0 )
+        {
+            play.code = pad.iEffect;
+            play.value = 0;
+            WriteEvent( pad.fd, play );
+        }
+        pad.uRumbleApplied = 0;
+        return;
+    }
+
+    struct ff_effect effect;
+    memset( &effect, 0, sizeof( effect ) );
+    effect.type = FF_RUMBLE;
+    effect.id = pad.iEffect;
+    effect.u.rumble.strong_magnitude = (unsigned short)( uRumble >> 16 );
+    effect.u.rumble.weak_magnitude = (unsigned short)( uRumble & 0xFFFF );
+    effect.replay.length = RUMBLE_LENGTH_MS;
+    if( ioctl( pad.fd, EVIOCSFF, &effect ) < 0 )
+    {
+        pad.bRumble = false;
+        myRumbleCapable[&pad - myPads].store( false );
+        return;
+    }
+    pad.iEffect = effect.id;
+
+    play.code = pad.iEffect;
+    play.value = 1;
+    WriteEvent( pad.fd, play );
+    pad.uRumbleApplied = uRumble;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: waitForInput()
+// Desc: Sleep in epoll_wait until a pad has events, a device node appeared,
+//       or timeoutMs passed.  The events themselves are read by read().
+//-----------------------------------------------------------------------------
+bool GamepadEvdev::waitForInput( int timeoutMs )
+{
+    if( myEpoll < 0 )
+        return GamepadSource::waitForInput( timeoutMs );
+
+    struct epoll_event events[MAX_CONTROLLERS + 1];
+    int n = epoll_wait( myEpoll, events, MAX_CONTROLLERS + 1, timeoutMs );
+    bool bInput = false;
+    for( int e = 0; e < n; e++ )
+    {
+        if( events[e].data.u32 != INOTIFY_TAG )
+        {
+            bInput = true;
+            continue;
+        }
+        // Only the fact that something changed matters
+        char buf[4096];
+        while( ::read( myInotify, buf, sizeof( buf ) ) > 0 )
+            ;
+        myRescan.store( true );
+        bInput = true;
+    }
+    return bInput;
+}
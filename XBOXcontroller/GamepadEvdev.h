@@ -0,0 +1,73 @@
+//-----------------------------------------------------------------------------
+// File: GamepadEvdev.h
+//
+// Linux evdev backend for GamepadSource.  Reads /dev/input/event* devices
+// that look like gamepads without blocking: the device fds are non-blocking
+// and sit in an epoll set together with an inotify watch on /dev/input for
+// hotplug, so the input thread sleeps in epoll_wait until something happens.
+// Every state is stamped with the kernel's event time, not the time it was
+// read.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "Gamepad.h"
+#include <atomic>
+#include <linux/input.h>
+
+class GamepadEvdev : public GamepadSource
+{
+public:
+    GamepadEvdev( const char *dir = "/dev/input" );
+    virtual ~GamepadEvdev();
+
+    virtual const char *getName() const { return "evdev"; }
+    virtual bool open();
+    virtual void read( GAMEPAD_STATE pads[MAX_CONTROLLERS] );
+    virtual bool waitForInput( int timeoutMs );
+    virtual void deviceChanged() { myRescan.store( true ); }
+    // Only records the request; the input thread uploads it on its next
+    // read(), so the device fd is never shared between threads
+    virtual bool setRumble( int slot, unsigned short wLeft, unsigned short wRight );
+
+protected:
+    struct AXIS_RANGE
+    {
+        int iMin;
+        int iMax;
+    };
+
+    struct EVDEV_PAD
+    {
+        int fd;
+        char szPath[64];
+        GAMEPAD_STATE current;     // what read() reports
+        GAMEPAD_STATE pending;     // built up until the next SYN_REPORT
+        bool bDropped;             // SYN_DROPPED seen, resync at the next SYN_REPORT
+        bool bAnalogTriggers;      // ABS_Z/ABS_RZ rather than BTN_TL2/BTN_TR2
+        bool bMonotonic;           // event times are CLOCK_MONOTONIC
+        bool bRumble;              // opened read-write and has FF_RUMBLE
+        short iEffect;             // uploaded rumble effect, -1 for none
+        unsigned int uRumbleApplied;
+        unsigned short wHatButtons;
+        AXIS_RANGE ranges[ABS_CNT];
+    };
+
+    void scan();
+    bool openDevice( const char *path );
+    void closeSlot( int i );
+    void drain( int i );
+    void handleEvent( EVDEV_PAD &pad, const struct input_event &ev );
+    void handleAxis( EVDEV_PAD &pad, int code, int value );
+    void resync( EVDEV_PAD &pad, long long llTimeUs );
+    void commit( EVDEV_PAD &pad, long long llTimeUs );
+    void applyRumble( EVDEV_PAD &pad, unsigned int uRumble );
+
+    char myDir[64];
+    int myEpoll;
+    int myInotify;
+    unsigned int myPacket;
+    std::atomic<bool> myRescan;
+    std::atomic<bool> myRumbleCapable[MAX_CONTROLLERS];
+    std::atomic<unsigned int> myRumble[MAX_CONTROLLERS];   // left << 16 | right
+    EVDEV_PAD myPads[MAX_CONTROLLERS];
+};
@@ -0,0 +1,220 @@
+//-----------------------------------------------------------------------------
+// File: GamepadReplay.cpp
+//
+// Record and replay for GamepadSource
+//-----------------------------------------------------------------------------
+#include "GamepadReplay.h"
+#include "HighResClock.h"
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+GamepadRecorder::GamepadRecorder( GamepadSource *source ) :
+    mySource( source ),
+    myStartUs( 0 ),
+    myHaveLast( false ),
+    myConnectCB( this, &GamepadRecorder::handleConnect ),
+    myDisconnectCB( this, &GamepadRecorder::handleDisconnect )
+{
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        myLastPacket[i] = 0;
+        myLastConnected[i] = false;
+    }
+    mySource->addConnectCB( &myConnectCB );
+    mySource->addDisconnectCB( &myDisconnectCB );
+}
+
+
+//-----------------------------------------------------------------------------
+GamepadRecorder::~GamepadRecorder()
+{
+    mySource->remConnectCB( &myConnectCB );
+    mySource->remDisconnectCB( &myDisconnectCB );
+}
+
+
+//-----------------------------------------------------------------------------
+bool GamepadRecorder::open( const char *path )
+{
+    myStartUs = MonotonicMicros();
+    myHaveLast = false;
+    return myWriter.open( path, MAX_CONTROLLERS, myStartUs );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: read()
+// Desc: Pass the state through, logging the slots that changed.  The first
+//       read logs every slot so the replay starts from the same state.
+//-----------------------------------------------------------------------------
+void GamepadRecorder::read( GAMEPAD_STATE pads[MAX_CONTROLLERS] )
+{
+    mySource->read( pads );
+    if( !myWriter.isOpen() )
+        return;
+
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        const GAMEPAD_STATE &pad = pads[i];
+        if( myHaveLast && pad.bConnected == myLastConnected[i] && pad.uPacket == myLastPacket[i] )
+            continue;
+        myLastConnected[i] = pad.bConnected;
+        myLastPacket[i] = pad.uPacket;
+
+        INPUT_LOG_RECORD record;
+        memset( &record, 0, sizeof( record ) );
+        record.llTimeUs = pad.llTimeUs > myStartUs ? pad.llTimeUs - myStartUs : 0;
+        record.uPacket = pad.uPacket;
+        record.wButtons = pad.wButtons;
+        record.bLeftTrigger = pad.bLeftTrigger;
+        record.bRightTrigger = pad.bRightTrigger;
+        record.sThumbLX = pad.sThumbLX;
+        record.sThumbLY = pad.sThumbLY;
+        record.sThumbRX = pad.sThumbRX;
+        record.sThumbRY = pad.sThumbRY;
+        record.bSlot = (unsigned char)i;
+        record.bConnected = pad.bConnected ? 1 : 0;
+        if( !myWriter.write( record ) )
+        {
+            ArLog::log( ArLog::Terse, "GamepadRecorder: write failed, no longer recording" );
+            myWriter.close();
+            return;
+        }
+    }
+    myHaveLast = true;
+}
+
+
+//-----------------------------------------------------------------------------
+GamepadReplay::GamepadReplay( Timing timing ) :
+    myTiming( timing ),
+    myNext( 0 ),
+    myStartUs( 0 ),
+    myEnded( false )
+{
+    memset( myPads, 0, sizeof( myPads ) );
+}
+
+
+//-----------------------------------------------------------------------------
+bool GamepadReplay::load( const char *path )
+{
+    myNext = 0;
+    myEnded = false;
+    memset( myPads, 0, sizeof( myPads ) );
+    if( !myLog.open( path ) )
+        return false;
+    ArLog::log( ArLog::Normal, "GamepadReplay: %u records from %s", myLog.getCount(), path );
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+bool GamepadReplay::open()
+{
+    myStartUs = MonotonicMicros();
+    return myLog.getRecords() != nullptr;
+}
+
+
+//-----------------------------------------------------------------------------
+void GamepadReplay::apply( const INPUT_LOG_RECORD &record, long long llTimeUs )
+{
+    if( record.bSlot >= MAX_CONTROLLERS )
+        return;
+
+    GAMEPAD_STATE &pad = myPads[record.bSlot];
+    bool bWasConnected = pad.bConnected;
+    pad.uPacket = record.uPacket;
+    pad.wButtons = record.wButtons;
+    pad.bLeftTrigger = record.bLeftTrigger;
+    pad.bRightTrigger = record.bRightTrigger;
+    pad.sThumbLX = record.sThumbLX;
+    pad.sThumbLY = record.sThumbLY;
+    pad.sThumbRX = record.sThumbRX;
+    pad.sThumbRY = record.sThumbRY;
+    pad.bConnected = record.bConnected != 0;
+    pad.llTimeUs = llTimeUs;
+
+    if( pad.bConnected != bWasConnected )
+        notifyConnection( record.bSlot, pad.bConnected );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: read()
+// Desc: REPLAY_ORIGINAL applies every record that is due by now.
+//       REPLAY_FAST applies the next group of records that share a
+//       timestamp, so a sample never mixes two moments of the session.
+//       Once the last record has been read the pads disconnect, so a log
+//       that ends with a stick held does not keep driving.
+//-----------------------------------------------------------------------------
+void GamepadReplay::read( GAMEPAD_STATE pads[MAX_CONTROLLERS] )
+{
+    const INPUT_LOG_RECORD *records = myLog.getRecords();
+    unsigned int count = myLog.getCount();
+    long long llNowUs = MonotonicMicros();
+
+    if( isFinished() && !myEnded )
+    {
+        myEnded = true;
+        for( int i = 0; i < MAX_CONTROLLERS; i++ )
+        {
+            if( !myPads[i].bConnected )
+                continue;
+            unsigned int uPacket = myPads[i].uPacket;
+            memset( &myPads[i], 0, sizeof( myPads[i] ) );
+            myPads[i].uPacket = uPacket + 1;
+            myPads[i].llTimeUs = llNowUs;
+            notifyConnection( i, false );
+        }
+    }
+
+    if( myTiming == REPLAY_FAST )
+    {
+        if( myNext < count )
+        {
+            long long llGroupUs = records[myNext].llTimeUs;
+            while( myNext < count && records[myNext].llTimeUs == llGroupUs )
+                apply( records[myNext++], llNowUs );
+        }
+    }
+    else
+    {
+        long long llElapsedUs = llNowUs - myStartUs;
+        while( myNext < count && records[myNext].llTimeUs <= llElapsedUs )
+        {
+            apply( records[myNext], myStartUs + records[myNext].llTimeUs );
+            myNext++;
+        }
+    }
+
+    memcpy( pads, myPads, sizeof( myPads ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: waitForInput()
+// Desc: Like an event-driven source, return as soon as the next record is
+//       due.  REPLAY_FAST never waits until the log runs out.
+//-----------------------------------------------------------------------------
+bool GamepadReplay::waitForInput( int timeoutMs )
+{
+    if( isFinished() )
+        return GamepadSource::waitForInput( timeoutMs );
+    if( myTiming == REPLAY_FAST )
+        return true;
+
+    long long llDueUs = myStartUs + myLog.getRecords()[myNext].llTimeUs - MonotonicMicros();
+    if( llDueUs <= 0 )
+        return true;
+    if( llDueUs < (long long)timeoutMs * 1000 )
+    {
+        // Round up so we do not wake just before the record is due
+        ArUtil::sleep( (unsigned int)( ( llDueUs + 999 ) / 1000 ) );
+        return true;
+    }
+    ArUtil::sleep( timeoutMs );
+    return false;
+}
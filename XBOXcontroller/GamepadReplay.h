@@ -0,0 +1,76 @@
+//-----------------------------------------------------------------------------
+// File: GamepadReplay.h
+//
+// Record and replay for GamepadSource.  GamepadRecorder sits between a real
+// source and the input thread and logs every change; GamepadReplay plays a
+// log back as if the pads were connected, at the original timing or as fast
+// as the input thread can take it.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "Gamepad.h"
+#include "InputLog.h"
+
+class GamepadRecorder : public GamepadSource
+{
+public:
+    GamepadRecorder( GamepadSource *source );
+    virtual ~GamepadRecorder();
+
+    // Start logging to path; call before the input thread starts
+    bool open( const char *path );
+    unsigned int getRecords() const { return myWriter.getRecords(); }
+
+    virtual const char *getName() const { return mySource->getName(); }
+    virtual bool open() { return mySource->open(); }
+    virtual void read( GAMEPAD_STATE pads[MAX_CONTROLLERS] );
+    virtual bool waitForInput( int timeoutMs ) { return mySource->waitForInput( timeoutMs ); }
+    virtual void deviceChanged() { mySource->deviceChanged(); }
+    virtual bool setRumble( int slot, unsigned short wLeft, unsigned short wRight )
+    { return mySource->setRumble( slot, wLeft, wRight ); }
+
+protected:
+    void handleConnect( int slot ) { notifyConnection( slot, true ); }
+    void handleDisconnect( int slot ) { notifyConnection( slot, false ); }
+
+    GamepadSource *mySource;
+    InputLogWriter myWriter;
+    long long myStartUs;
+    bool myHaveLast;
+    unsigned int myLastPacket[MAX_CONTROLLERS];
+    bool myLastConnected[MAX_CONTROLLERS];
+    ArFunctor1C<GamepadRecorder, int> myConnectCB;
+    ArFunctor1C<GamepadRecorder, int> myDisconnectCB;
+};
+
+class GamepadReplay : public GamepadSource
+{
+public:
+    enum Timing
+    {
+        REPLAY_ORIGINAL,   // same spacing between records as when recorded
+        REPLAY_FAST        // next record on every read
+    };
+
+    GamepadReplay( Timing timing = REPLAY_ORIGINAL );
+
+    // Map path; call before the input thread starts
+    bool load( const char *path );
+    bool isFinished() const { return myNext >= myLog.getCount(); }
+    unsigned int getCount() const { return myLog.getCount(); }
+
+    virtual const char *getName() const { return "replay"; }
+    virtual bool open();
+    virtual void read( GAMEPAD_STATE pads[MAX_CONTROLLERS] );
+    virtual bool waitForInput( int timeoutMs );
+
+protected:
+    void apply( const INPUT_LOG_RECORD &record, long long llTimeUs );
+
+    Timing myTiming;
+    InputLogReader myLog;
+    unsigned int myNext;
+    long long myStartUs;
+    bool myEnded;
+    GAMEPAD_STATE myPads[MAX_CONTROLLERS];
+};
@@ -0,0 +1,78 @@
+//-----------------------------------------------------------------------------
+// File: GamepadXInput.cpp
+//
+// XInput backend for GamepadSource
+//-----------------------------------------------------------------------------
+#include "GamepadXInput.h"
+#include "HighResClock.h"
+#include <string.h>
+
+static_assert( GAMEPAD_A == XINPUT_GAMEPAD_A && GAMEPAD_DPAD_UP == XINPUT_GAMEPAD_DPAD_UP &&
+               GAMEPAD_RIGHT_SHOULDER == XINPUT_GAMEPAD_RIGHT_SHOULDER,
+               "GAMEPAD_BUTTON bits are the XInput ones" );
+
+
+//-----------------------------------------------------------------------------
+GamepadXInput::GamepadXInput()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: read()
+// Desc: XInput has no events or timestamps, so every connected slot is
+//       read and stamped with the time of the read.  Empty slots are only
+//       probed now and then.
+//-----------------------------------------------------------------------------
+void GamepadXInput::read( GAMEPAD_STATE pads[MAX_CONTROLLERS] )
+{
+    ArTime now;
+    long long llNowUs = MonotonicMicros();
+
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        GAMEPAD_STATE &pad = pads[i];
+        XINPUT_STATE state;
+        bool bConnected = false;
+
+        if( myConnections.shouldPoll( i, now ) )
+        {
+            bConnected = ( XInputGetState( i, &state ) == ERROR_SUCCESS );
+            if( myConnections.reportPoll( i, bConnected, now ) )
+                notifyConnection( i, bConnected );
+        }
+
+        memset( &pad, 0, sizeof( pad ) );
+        pad.llTimeUs = llNowUs;
+        if( !bConnected )
+            continue;
+
+        // XInput bumps dwPacketNumber whenever anything on the pad changes
+        pad.bConnected = true;
+        pad.uPacket = state.dwPacketNumber;
+        pad.wButtons = state.Gamepad.wButtons;
+        pad.bLeftTrigger = state.Gamepad.bLeftTrigger;
+        pad.bRightTrigger = state.Gamepad.bRightTrigger;
+        pad.sThumbLX = state.Gamepad.sThumbLX;
+        pad.sThumbLY = state.Gamepad.sThumbLY;
+        pad.sThumbRX = state.Gamepad.sThumbRX;
+        pad.sThumbRY = state.Gamepad.sThumbRY;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: setRumble()
+// Desc: XInputSetState is safe from any thread.  Like XInputGetState it is
+//       slow on an empty slot, so only slots we have seen connected are
+//       tried.
+//-----------------------------------------------------------------------------
+bool GamepadXInput::setRumble( int slot, unsigned short wLeft, unsigned short wRight )
+{
+    if( slot < 0 || slot >= MAX_CONTROLLERS || !myConnections.isConnected( slot ) )
+        return false;
+    XINPUT_VIBRATION vibration;
+    vibration.wLeftMotorSpeed = wLeft;
+    vibration.wRightMotorSpeed = wRight;
+    return XInputSetState( slot, &vibration ) == ERROR_SUCCESS;
+}
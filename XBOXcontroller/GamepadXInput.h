@@ -0,0 +1,41 @@
+//-----------------------------------------------------------------------------
+// File: GamepadXInput.h
+//
+// XInput backend for GamepadSource (Windows only)
+//-----------------------------------------------------------------------------
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#ifdef USE_DIRECTX_SDK
+#include <C:\Program Files (x86)\Microsoft DirectX SDK (June 2010)\include\xinput.h>
+#pragma comment(lib,"xinput.lib")
+#elif (_WIN32_WINNT >= 0x0602 /*_WIN32_WINNT_WIN8*/)
+#include <XInput.h>
+#pragma comment(lib,"xinput.lib")
+#else
+#include <XInput.h>
+#pragma comment(lib,"xinput9_1_0.lib")
+#endif
+
+#include "Gamepad.h"
+#include "ControllerConnection.h"
+
+class GamepadXInput : public GamepadSource
+{
+public:
+    GamepadXInput();
+
+    virtual const char *getName() const { return "XInput"; }
+    virtual void read( GAMEPAD_STATE pads[MAX_CONTROLLERS] );
+    // WM_DEVICECHANGE; probe the empty slots on the next read
+    virtual void deviceChanged() { myConnections.deviceChanged(); }
+    virtual bool setRumble( int slot, unsigned short wLeft, unsigned short wRight );
+
+    // Which slots get read
+    ControllerConnectionManager *getConnectionManager() { return &myConnections; }
+
+protected:
+    ControllerConnectionManager myConnections;
+};
@@ -0,0 +1,158 @@
+//-----------------------------------------------------------------------------
+// File: HeadlessMain.cpp
+//
+// Console and daemon front end
+//-----------------------------------------------------------------------------
+#include "HeadlessMain.h"
+#include "ControllerBridge.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WIN32
+#include "GamepadXInput.h"
+#else
+#include "GamepadEvdev.h"
+#endif
+
+#define HEADLESS_LOG_FILE "controller.log"
+
+// The shortcuts do directly what the window's keys would
+#define PAD_ACTION_DEADZONE    ( DRIVE_ACTION_FIRST_FREE )
+#define PAD_ACTION_LOG_LATENCY ( DRIVE_ACTION_FIRST_FREE + 1 )
+
+static const BUTTON_RULE HEADLESS_SHORTCUTS[] =
+{
+    { GAMEPAD_Y, BUTTON_DOUBLE_TAP, 300, PAD_ACTION_DEADZONE },
+    { GAMEPAD_LEFT_SHOULDER | GAMEPAD_RIGHT_SHOULDER, BUTTON_HOLD, 1000, PAD_ACTION_LOG_LATENCY },
+};
+
+static ControllerBridge *g_pHeadlessBridge = nullptr;
+
+
+//-----------------------------------------------------------------------------
+bool TakeArgument( int *argc, char **argv, const char *name )
+{
+    for( int i = 1; i < *argc; i++ )
+    {
+        if( strcmp( argv[i], name ) != 0 )
+            continue;
+        for( int j = i; j + 1 < *argc; j++ )
+            argv[j] = argv[j + 1];
+        ( *argc )--;
+        return true;
+    }
+    return false;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: TakeArgumentValue()
+// Desc: Remove name and the value after it from argv
+//-----------------------------------------------------------------------------
+static const char *TakeArgumentValue( int *argc, char **argv, const char *name )
+{
+    for( int i = 1; i + 1 < *argc; i++ )
+    {
+        if( strcmp( argv[i], name ) != 0 )
+            continue;
+        const char *value = argv[i + 1];
+        for( int j = i; j + 2 < *argc; j++ )
+            argv[j] = argv[j + 2];
+        *argc -= 2;
+        return value;
+    }
+    return nullptr;
+}
+
+
+//-----------------------------------------------------------------------------
+static void padToggleDeadZone( int slot )
+{
+    ControllerInputThread *input = g_pHeadlessBridge->getInputThread();
+    input->setDeadZone( !input->getDeadZone() );
+    ArLog::log( ArLog::Normal, "Dead zone %s (pad %d)", input->getDeadZone() ? "on" : "off", slot );
+}
+
+
+//-----------------------------------------------------------------------------
+static void padLogLatency( int )
+{
+    g_pHeadlessBridge->logLatency();
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: RunHeadless()
+// Desc: Nothing is waited for that only a person watching would need: no
+//       window, no settling nudge, so the pads drive as soon as the robot
+//       and the input thread are up.
+//-----------------------------------------------------------------------------
+int RunHeadless( int argc, char **argv )
+{
+    BRIDGE_MODE mode = BRIDGE_CONSOLE;
+#ifndef WIN32
+    // Always headless here; accept the Windows spelling anyway
+    TakeArgument( &argc, argv, "-headless" );
+    const char *logFile = TakeArgumentValue( &argc, argv, "-logFile" );
+    // Takes -daemonize out of argv itself.  It does not chdir, so a
+    // relative log file still lands where we were started.  Must happen
+    // before Aria::init() starts any thread.
+    ArDaemonizer daemonizer( &argc, argv, true );
+    if( !daemonizer.daemonize() )
+    {
+        fprintf( stderr, "Could not detach from the terminal\n" );
+        return 1;
+    }
+    if( daemonizer.isDaemonized() )
+    {
+        if( logFile == nullptr )
+            logFile = HEADLESS_LOG_FILE;
+        mode = BRIDGE_DAEMON;
+    }
+#endif
+
+    Aria::init();
+#ifndef WIN32
+    if( mode == BRIDGE_DAEMON )
+        ArLog::init( ArLog::File, ArLog::Normal, logFile, true );
+#endif
+
+#ifdef WIN32
+    GamepadXInput pads;
+#else
+    GamepadEvdev pads;
+#endif
+    ControllerBridge bridge( &pads );
+    g_pHeadlessBridge = &bridge;
+    if( !bridge.connect( &argc, argv, mode ) )
+    {
+        Aria::exit( 1 );
+        return 1;
+    }
+
+    ArGlobalFunctor1<int> padDeadZoneCB( &padToggleDeadZone );
+    ArGlobalFunctor1<int> padLogLatencyCB( &padLogLatency );
+    bridge.setPadShortcuts( HEADLESS_SHORTCUTS, sizeof( HEADLESS_SHORTCUTS ) / sizeof( HEADLESS_SHORTCUTS[0] ) );
+    bridge.setPadAction( PAD_ACTION_DEADZONE, &padDeadZoneCB );
+    bridge.setPadAction( PAD_ACTION_LOG_LATENCY, &padLogLatencyCB );
+    bridge.start();
+    bridge.setEasyRotate( true );
+
+    // Until the connection is lost, Escape, or Aria::exit()
+    bridge.getRobot()->waitForRunExit();
+
+    bridge.stop();
+    g_pHeadlessBridge = nullptr;
+    Aria::exit( 0 );
+    return 0;
+}
+
+
+#ifndef WIN32
+//-----------------------------------------------------------------------------
+int main( int argc, char **argv )
+{
+    return RunHeadless( argc, argv );
+}
+#endif
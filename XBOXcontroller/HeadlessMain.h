@@ -0,0 +1,17 @@
+//-----------------------------------------------------------------------------
+// File: HeadlessMain.h
+//
+// Console and daemon front end: no window, no message loop, just the input
+// and drive threads plus the telemetry endpoint.  On Windows it is the same
+// executable started with -headless; elsewhere it is the program's main().
+//-----------------------------------------------------------------------------
+#pragma once
+
+// Runs until the robot disconnects or the program is told to exit.  Calls
+// Aria::init() itself.
+//   -daemonize                      (not Windows) detach and log to a file
+//   -logFile <file>                 where a daemon logs, default controller.log
+int RunHeadless( int argc, char **argv );
+
+// Remove name from argv if it is there
+bool TakeArgument( int *argc, char **argv, const char *name );
@@ -0,0 +1,33 @@
+//-----------------------------------------------------------------------------
+// File: HighResClock.h
+//
+// Monotonic microsecond clock.  ArTime only has millisecond resolution,
+// which is too coarse for input timestamps.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+inline long long MonotonicMicros()
+{
+#ifdef WIN32
+    static LARGE_INTEGER s_frequency = { 0 };
+    if( s_frequency.QuadPart == 0 )
+        QueryPerformanceFrequency( &s_frequency );
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter( &counter );
+    // Split to avoid overflowing counter * 1000000
+    long long seconds = counter.QuadPart / s_frequency.QuadPart;
+    long long rest = counter.QuadPart % s_frequency.QuadPart;
+    return seconds * 1000000 + rest * 1000000 / s_frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
@@ -0,0 +1,192 @@
+//-----------------------------------------------------------------------------
+// File: InputLog.cpp
+//
+// Binary log of gamepad samples
+//-----------------------------------------------------------------------------
+#include "InputLog.h"
+#include <string.h>
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+//-----------------------------------------------------------------------------
+InputLogWriter::InputLogWriter() :
+    myFile( nullptr ),
+    myRecords( 0 )
+{
+}
+
+
+//-----------------------------------------------------------------------------
+InputLogWriter::~InputLogWriter()
+{
+    close();
+}
+
+
+//-----------------------------------------------------------------------------
+bool InputLogWriter::open( const char *path, unsigned short wSlots, long long llStartUs )
+{
+    close();
+    myFile = fopen( path, "wb" );
+    if( myFile == nullptr )
+        return false;
+    // Big enough that the input thread rarely waits on the disk
+    setvbuf( myFile, nullptr, _IOFBF, 64 * 1024 );
+
+    INPUT_LOG_HEADER header;
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.szMagic, INPUT_LOG_MAGIC, 4 );
+    header.wVersion = INPUT_LOG_VERSION;
+    header.wRecordSize = sizeof( INPUT_LOG_RECORD );
+    header.wSlots = wSlots;
+    header.llStartUs = llStartUs;
+    if( fwrite( &header, sizeof( header ), 1, myFile ) != 1 )
+    {
+        close();
+        return false;
+    }
+    myRecords = 0;
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+void InputLogWriter::close()
+{
+    if( myFile == nullptr )
+        return;
+    fclose( myFile );
+    myFile = nullptr;
+}
+
+
+//-----------------------------------------------------------------------------
+bool InputLogWriter::write( const INPUT_LOG_RECORD &record )
+{
+    if( myFile == nullptr || fwrite( &record, sizeof( record ), 1, myFile ) != 1 )
+        return false;
+    myRecords++;
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+InputLogReader::InputLogReader() :
+    myHeader( nullptr ),
+    myRecords( nullptr ),
+    myCount( 0 ),
+    myView( nullptr ),
+    myViewSize( 0 )
+#ifdef WIN32
+    , myFileHandle( INVALID_HANDLE_VALUE ),
+    myMapping( nullptr )
+#endif
+{
+}
+
+
+//-----------------------------------------------------------------------------
+InputLogReader::~InputLogReader()
+{
+    close();
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: open()
+// Desc: Map path and check that it is a log this build can read
+//-----------------------------------------------------------------------------
+bool InputLogReader::open( const char *path )
+{
+    close();
+
+#ifdef WIN32
+    myFileHandle = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if( myFileHandle == INVALID_HANDLE_VALUE )
+        return false;
+    LARGE_INTEGER size;
+    if( !GetFileSizeEx( myFileHandle, &size ) || size.QuadPart < (LONGLONG)sizeof( INPUT_LOG_HEADER ) )
+    {
+        close();
+        return false;
+    }
+    myMapping = CreateFileMapping( myFileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if( myMapping == nullptr )
+    {
+        close();
+        return false;
+    }
+    myView = MapViewOfFile( myMapping, FILE_MAP_READ, 0, 0, 0 );
+    myViewSize = size_t( size.QuadPart );
+#else
+    int fd = ::open( path, O_RDONLY | O_CLOEXEC );
+    if( fd < 0 )
+        return false;
+    struct stat st;
+    if( fstat( fd, &st ) < 0 || st.st_size < (off_t)sizeof( INPUT_LOG_HEADER ) )
+    {
+        ::close( fd );
+        return false;
+    }
+    myViewSize = size_t( st.st_size );
+    myView = mmap( nullptr, myViewSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+    // The mapping keeps the file alive
+    ::close( fd );
+    if( myView == MAP_FAILED )
+        myView = nullptr;
+#endif
+
+    if( myView == nullptr )
+    {
+        close();
+        return false;
+    }
+
+    const INPUT_LOG_HEADER *header = (const INPUT_LOG_HEADER *)myView;
+    if( memcmp( header->szMagic, INPUT_LOG_MAGIC, 4 ) != 0 ||
+        header->wVersion != INPUT_LOG_VERSION ||
+        header->wRecordSize != sizeof( INPUT_LOG_RECORD ) )
+    {
+        close();
+        return false;
+    }
+
+    myHeader = header;
+    myRecords = (const INPUT_LOG_RECORD *)( header + 1 );
+    // A partial record at the end is from a writer that did not finish
+    myCount = (unsigned int)( ( myViewSize - sizeof( INPUT_LOG_HEADER ) ) / sizeof( INPUT_LOG_RECORD ) );
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+void InputLogReader::close()
+{
+#ifdef WIN32
+    if( myView != nullptr )
+        UnmapViewOfFile( myView );
+    if( myMapping != nullptr )
+        CloseHandle( myMapping );
+    if( myFileHandle != INVALID_HANDLE_VALUE )
+        CloseHandle( myFileHandle );
+    myMapping = nullptr;
+    myFileHandle = INVALID_HANDLE_VALUE;
+#else
+    if( myView != nullptr )
+        munmap( myView, myViewSize );
+#endif
+    myView = nullptr;
+    myViewSize = 0;
+    myHeader = nullptr;
+    myRecords = nullptr;
+    myCount = 0;
+}
@@ -0,0 +1,95 @@
+//-----------------------------------------------------------------------------
+// File: InputLog.h
+//
+// Binary log of gamepad samples, for replaying a driving session without a
+// pad.  The file is a header followed by fixed-size records, little endian,
+// with no framing or compression, so a reader can map it and index records
+// directly.  A record is written only when a slot changed, and a file cut
+// short by a crash is still readable up to the last whole record.
+//
+// This file does not depend on ARIA so tools can use it on their own.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <stdio.h>
+
+#define INPUT_LOG_MAGIC   "XPAD"
+#define INPUT_LOG_VERSION 1
+
+struct INPUT_LOG_HEADER
+{
+    char           szMagic[4];      // INPUT_LOG_MAGIC, not terminated
+    unsigned short wVersion;
+    unsigned short wRecordSize;     // sizeof( INPUT_LOG_RECORD ) of the writer
+    unsigned short wSlots;          // controller slots the writer had
+    unsigned short wReserved;
+    unsigned int   uReserved;
+    long long      llStartUs;       // writer's MonotonicMicros() at open, for reference
+};
+
+// One slot's state at one point in time.  The fields after uPacket are the
+// XINPUT_GAMEPAD layout.
+struct INPUT_LOG_RECORD
+{
+    long long      llTimeUs;        // since the start of the log
+    unsigned int   uPacket;
+    unsigned short wButtons;
+    unsigned char  bLeftTrigger;
+    unsigned char  bRightTrigger;
+    short          sThumbLX;
+    short          sThumbLY;
+    short          sThumbRX;
+    short          sThumbRY;
+    unsigned char  bSlot;
+    unsigned char  bConnected;
+    unsigned short wReserved;
+    unsigned int   uReserved;
+};
+static_assert( sizeof( INPUT_LOG_HEADER ) == 24, "INPUT_LOG_HEADER is part of the file format" );
+static_assert( sizeof( INPUT_LOG_RECORD ) == 32, "INPUT_LOG_RECORD is part of the file format" );
+
+class InputLogWriter
+{
+public:
+    InputLogWriter();
+    ~InputLogWriter();
+
+    // Creates or truncates path and writes the header
+    bool open( const char *path, unsigned short wSlots, long long llStartUs );
+    void close();
+    bool isOpen() const { return myFile != nullptr; }
+
+    // Buffered; nothing reaches the disk until the buffer fills or close()
+    bool write( const INPUT_LOG_RECORD &record );
+    unsigned int getRecords() const { return myRecords; }
+
+protected:
+    FILE *myFile;
+    unsigned int myRecords;
+};
+
+// Maps a whole log read-only
+class InputLogReader
+{
+public:
+    InputLogReader();
+    ~InputLogReader();
+
+    bool open( const char *path );
+    void close();
+
+    const INPUT_LOG_HEADER *getHeader() const { return myHeader; }
+    const INPUT_LOG_RECORD *getRecords() const { return myRecords; }
+    unsigned int getCount() const { return myCount; }
+
+protected:
+    const INPUT_LOG_HEADER *myHeader;
+    const INPUT_LOG_RECORD *myRecords;
+    unsigned int myCount;
+    void *myView;
+    size_t myViewSize;
+#ifdef WIN32
+    void *myFileHandle;
+    void *myMapping;
+#endif
+};
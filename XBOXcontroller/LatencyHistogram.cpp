@@ -0,0 +1,103 @@
+//-----------------------------------------------------------------------------
+// File: LatencyHistogram.cpp
+//
+// Lock-free latency histogram
+//-----------------------------------------------------------------------------
+#include "LatencyHistogram.h"
+#include "Aria.h"
+
+
+//-----------------------------------------------------------------------------
+LatencyHistogram::LatencyHistogram() :
+    myCount( 0 ),
+    myMax( 0 )
+{
+    for( int i = 0; i < LATENCY_BUCKETS; i++ )
+        myBuckets[i].store( 0 );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: bucketOf()
+// Desc: Below LATENCY_LINEAR_US one bucket per microsecond; above it the
+//       position of the top bit picks the power of two and the next three
+//       bits pick one of its LATENCY_SUB_BUCKETS
+//-----------------------------------------------------------------------------
+int LatencyHistogram::bucketOf( long long us )
+{
+    if( us < LATENCY_LINEAR_US )
+        return int( us );
+    int top = 0;
+    for( unsigned long long v = (unsigned long long)us; v > 1; v >>= 1 )
+        top++;
+    int sub = int( ( us >> ( top - 3 ) ) & ( LATENCY_SUB_BUCKETS - 1 ) );
+    int bucket = LATENCY_LINEAR_US + ( top - 4 ) * LATENCY_SUB_BUCKETS + sub;
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+
+//-----------------------------------------------------------------------------
+long long LatencyHistogram::bucketTop( int bucket )
+{
+    if( bucket < LATENCY_LINEAR_US )
+        return bucket;
+    int top = ( bucket - LATENCY_LINEAR_US ) / LATENCY_SUB_BUCKETS + 4;
+    int sub = ( bucket - LATENCY_LINEAR_US ) % LATENCY_SUB_BUCKETS;
+    return ( ( 1LL << top ) | ( (long long)sub << ( top - 3 ) ) ) + ( 1LL << ( top - 3 ) ) - 1;
+}
+
+
+//-----------------------------------------------------------------------------
+void LatencyHistogram::add( long long us )
+{
+    if( us < 0 )
+        us = 0;
+    myBuckets[bucketOf( us )].fetch_add( 1 );
+    myCount.fetch_add( 1 );
+
+    long long max = myMax.load();
+    while( us > max && !myMax.compare_exchange_weak( max, us ) )
+        ;
+}
+
+
+//-----------------------------------------------------------------------------
+void LatencyHistogram::reset()
+{
+    for( int i = 0; i < LATENCY_BUCKETS; i++ )
+        myBuckets[i].store( 0 );
+    myCount.store( 0 );
+    myMax.store( 0 );
+}
+
+
+//-----------------------------------------------------------------------------
+long long LatencyHistogram::getPercentile( double fraction ) const
+{
+    unsigned int count = myCount.load();
+    if( count == 0 )
+        return 0;
+    unsigned int rank = (unsigned int)( fraction * count + 0.5 );
+    if( rank < 1 ) rank = 1;
+
+    unsigned int seen = 0;
+    for( int i = 0; i < LATENCY_BUCKETS; i++ )
+    {
+        seen += myBuckets[i].load();
+        if( seen >= rank )
+        {
+            long long top = bucketTop( i );
+            long long max = myMax.load();
+            return top < max ? top : max;
+        }
+    }
+    return myMax.load();
+}
+
+
+//-----------------------------------------------------------------------------
+void LatencyHistogram::log( const char *name ) const
+{
+    ArLog::log( ArLog::Normal, "%s: %u samples, p50 %lld us, p99 %lld us, max %lld us",
+                name, getCount(), getPercentile( 0.5 ), getPercentile( 0.99 ), getMax() );
+}
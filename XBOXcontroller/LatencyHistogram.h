@@ -0,0 +1,43 @@
+//-----------------------------------------------------------------------------
+// File: LatencyHistogram.h
+//
+// Lock-free latency histogram.  Any thread may add samples while another
+// reads percentiles; every counter is a separate atomic, so a report taken
+// while samples arrive is only off by the samples in flight.  Buckets are
+// log-linear: exact below LATENCY_LINEAR_US, then LATENCY_SUB_BUCKETS per
+// power of two, so a percentile is within 1/8 of its true value.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <atomic>
+
+#define LATENCY_LINEAR_US    16
+#define LATENCY_SUB_BUCKETS   8
+#define LATENCY_BUCKETS     256     // covers more than 2^31 us
+
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    // Negative samples (clocks that disagree) are counted as 0
+    void add( long long us );
+    void reset();
+
+    unsigned int getCount() const { return myCount.load(); }
+    long long getMax() const { return myMax.load(); }
+    // Upper bound of the bucket holding the given fraction of samples,
+    // 0.5 for the median; 0 with no samples
+    long long getPercentile( double fraction ) const;
+
+    // One ArLog line: count, p50, p99 and max
+    void log( const char *name ) const;
+
+protected:
+    static int bucketOf( long long us );
+    static long long bucketTop( int bucket );
+
+    std::atomic<unsigned int> myBuckets[LATENCY_BUCKETS];
+    std::atomic<unsigned int> myCount;
+    std::atomic<long long> myMax;
+};
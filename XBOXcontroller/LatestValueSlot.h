@@ -0,0 +1,78 @@
+//-----------------------------------------------------------------------------
+// File: LatestValueSlot.h
+//
+// Lock-free single-producer/single-consumer "latest value" mailbox.
+//
+// This is a triple buffer: the producer always has a private buffer to write
+// into, the consumer always has a private buffer to read from, and the third
+// buffer is swapped between them with one atomic exchange.  Neither side ever
+// waits for the other.  Values the consumer did not get to in time are simply
+// replaced by newer ones, which is what we want for controller state.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <atomic>
+
+template <class T>
+class LatestValueSlot
+{
+public:
+    LatestValueSlot() : myBack( 0 ), myShared( 1 ), myFront( 2 ) {}
+
+    //-------------------------------------------------------------------------
+    // Producer side
+    //-------------------------------------------------------------------------
+
+    // Buffer the producer may fill before calling publish()
+    T *beginWrite() { return &myBuffers[myBack]; }
+
+    // Hand the buffer from beginWrite() to the consumer
+    void publish()
+    {
+        myBack = myShared.exchange( myBack | DIRTY, std::memory_order_acq_rel ) & INDEX_MASK;
+    }
+
+    void publish( const T &value )
+    {
+        myBuffers[myBack] = value;
+        publish();
+    }
+
+    //-------------------------------------------------------------------------
+    // Consumer side
+    //-------------------------------------------------------------------------
+
+    // Is there a value the consumer has not seen yet?
+    bool hasNew() const
+    {
+        return ( myShared.load( std::memory_order_acquire ) & DIRTY ) != 0;
+    }
+
+    // Returns the newest value if one was published since the last call,
+    // otherwise nullptr.  The pointer stays valid until the next consume().
+    const T *consume()
+    {
+        if( !hasNew() )
+            return nullptr;
+        myFront = myShared.exchange( myFront, std::memory_order_acq_rel ) & INDEX_MASK;
+        return &myBuffers[myFront];
+    }
+
+    // The value returned by the last successful consume()
+    const T *peek() const { return &myBuffers[myFront]; }
+
+private:
+    enum { INDEX_MASK = 0x3, DIRTY = 0x4 };
+
+    // Keep the producer's and the consumer's indices on separate cache lines
+    T myBuffers[3];
+    unsigned int myBack;
+    char myPad1[64];
+    std::atomic<unsigned int> myShared;
+    char myPad2[64];
+    unsigned int myFront;
+
+    // Not copyable
+    LatestValueSlot( const LatestValueSlot & );
+    LatestValueSlot &operator=( const LatestValueSlot & );
+};
@@ -0,0 +1,135 @@
+//-----------------------------------------------------------------------------
+// File: PacketDispatcher.cpp
+//
+// Robot packets to their handlers by ID
+//-----------------------------------------------------------------------------
+#include "PacketDispatcher.h"
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+PacketDispatcher::PacketDispatcher( ArRobot *robot ) :
+    myRobot( robot ),
+    myFallbackCount( 0 ),
+    myDispatched( 0 ),
+    myFallbacks( 0 ),
+    myHandlerCB( this, &PacketDispatcher::handlePacket )
+{
+    memset( myCounts, 0, sizeof( myCounts ) );
+    myRobot->lock();
+    myRobot->addPacketHandler( &myHandlerCB, ArListPos::LAST );
+    myRobot->unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+PacketDispatcher::~PacketDispatcher()
+{
+    myRobot->lock();
+    myRobot->remPacketHandler( &myHandlerCB );
+    myRobot->unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+bool PacketDispatcher::add( ArRetFunctor1<bool, ArRobotPacket *> **list, unsigned char *count, int max,
+                            ArRetFunctor1<bool, ArRobotPacket *> *functor )
+{
+    if( *count >= max )
+        return false;
+    list[( *count )++] = functor;
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: rem()
+// Desc: Keeps the order of the rest, which is the order they are tried in
+//-----------------------------------------------------------------------------
+void PacketDispatcher::rem( ArRetFunctor1<bool, ArRobotPacket *> **list, unsigned char *count,
+                            ArRetFunctor1<bool, ArRobotPacket *> *functor )
+{
+    for( int i = 0; i < *count; i++ )
+    {
+        if( list[i] != functor )
+            continue;
+        for( int j = i + 1; j < *count; j++ )
+            list[j - 1] = list[j];
+        ( *count )--;
+        return;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+bool PacketDispatcher::addHandler( unsigned char id, ArRetFunctor1<bool, ArRobotPacket *> *functor )
+{
+    myRobot->lock();
+    bool bAdded = add( myHandlers[id], &myCounts[id], PACKET_DISPATCH_PER_ID, functor );
+    myRobot->unlock();
+    if( !bAdded )
+        ArLog::log( ArLog::Terse, "PacketDispatcher: no room for another handler for packet 0x%x", id );
+    return bAdded;
+}
+
+
+//-----------------------------------------------------------------------------
+void PacketDispatcher::remHandler( unsigned char id, ArRetFunctor1<bool, ArRobotPacket *> *functor )
+{
+    myRobot->lock();
+    rem( myHandlers[id], &myCounts[id], functor );
+    myRobot->unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+bool PacketDispatcher::addFallbackHandler( ArRetFunctor1<bool, ArRobotPacket *> *functor )
+{
+    myRobot->lock();
+    bool bAdded = add( myFallbackHandlers, &myFallbackCount, PACKET_DISPATCH_FALLBACKS, functor );
+    myRobot->unlock();
+    if( !bAdded )
+        ArLog::log( ArLog::Terse, "PacketDispatcher: no room for another fallback handler" );
+    return bAdded;
+}
+
+
+//-----------------------------------------------------------------------------
+void PacketDispatcher::remFallbackHandler( ArRetFunctor1<bool, ArRobotPacket *> *functor )
+{
+    myRobot->lock();
+    rem( myFallbackHandlers, &myFallbackCount, functor );
+    myRobot->unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: handlePacket()
+// Desc: ArRobot packet handler.  Each handler gets the packet from the start
+//       of its data, as it would from ArRobot.
+//-----------------------------------------------------------------------------
+bool PacketDispatcher::handlePacket( ArRobotPacket *packet )
+{
+    unsigned char id = packet->getID();
+    ArRetFunctor1<bool, ArRobotPacket *> **handlers = myHandlers[id];
+    for( int i = 0; i < myCounts[id]; i++ )
+    {
+        packet->resetRead();
+        if( handlers[i]->invokeR( packet ) )
+        {
+            myDispatched++;
+            return true;
+        }
+    }
+    for( int i = 0; i < myFallbackCount; i++ )
+    {
+        packet->resetRead();
+        if( myFallbackHandlers[i]->invokeR( packet ) )
+        {
+            myFallbacks++;
+            return true;
+        }
+    }
+    packet->resetRead();
+    return false;
+}
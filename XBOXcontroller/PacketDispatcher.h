@@ -0,0 +1,55 @@
+//-----------------------------------------------------------------------------
+// File: PacketDispatcher.h
+//
+// ArRobot offers every packet to each of its packet handlers in turn until
+// one takes it, so every handler starts by checking the packet ID.  The
+// dispatcher is one of those handlers and looks the ID up in a table
+// instead: handlers registered for an ID are the only ones that see it, and
+// handlers that want anything go on a fallback list that is tried when no
+// ID handler took the packet.  Dispatch costs the same however many
+// handlers there are.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "Aria.h"
+
+#define PACKET_DISPATCH_IDS       256
+#define PACKET_DISPATCH_PER_ID      4
+#define PACKET_DISPATCH_FALLBACKS   8
+
+class PacketDispatcher
+{
+public:
+    // Joins the end of robot's packet handlers
+    PacketDispatcher( ArRobot *robot );
+    ~PacketDispatcher();
+
+    // Any thread.  A handler returns true when it has taken the packet.
+    // False if the ID or the fallback list is full.
+    bool addHandler( unsigned char id, ArRetFunctor1<bool, ArRobotPacket *> *functor );
+    void remHandler( unsigned char id, ArRetFunctor1<bool, ArRobotPacket *> *functor );
+    bool addFallbackHandler( ArRetFunctor1<bool, ArRobotPacket *> *functor );
+    void remFallbackHandler( ArRetFunctor1<bool, ArRobotPacket *> *functor );
+
+    // Packets an ID handler took, and packets that went to the fallbacks
+    unsigned int getDispatched() const { return myDispatched; }
+    unsigned int getFallbacks() const { return myFallbacks; }
+
+protected:
+    bool handlePacket( ArRobotPacket *packet );
+    static bool add( ArRetFunctor1<bool, ArRobotPacket *> **list, unsigned char *count, int max,
+                     ArRetFunctor1<bool, ArRobotPacket *> *functor );
+    static void rem( ArRetFunctor1<bool, ArRobotPacket *> **list, unsigned char *count,
+                     ArRetFunctor1<bool, ArRobotPacket *> *functor );
+
+    ArRobot *myRobot;
+    // Only changed with the robot locked, which is how ArRobot calls handlers
+    ArRetFunctor1<bool, ArRobotPacket *> *myHandlers[PACKET_DISPATCH_IDS][PACKET_DISPATCH_PER_ID];
+    unsigned char myCounts[PACKET_DISPATCH_IDS];
+    ArRetFunctor1<bool, ArRobotPacket *> *myFallbackHandlers[PACKET_DISPATCH_FALLBACKS];
+    unsigned char myFallbackCount;
+    unsigned int myDispatched;
+    unsigned int myFallbacks;
+
+    ArRetFunctor1C<bool, PacketDispatcher, ArRobotPacket *> myHandlerCB;
+};
@@ -0,0 +1,198 @@
+//-----------------------------------------------------------------------------
+// File: PacketPool.cpp
+//
+// Received robot packets shared with other threads
+//-----------------------------------------------------------------------------
+#include "PacketPool.h"
+#include "HighResClock.h"
+#include <new>
+#include <string.h>
+
+static_assert( sizeof( POOLED_PACKET ) == PACKET_POOL_SLOT, "POOLED_PACKET must fill its slot exactly" );
+
+
+//-----------------------------------------------------------------------------
+// Name: PacketPool()
+// Desc: The one allocation: every slot, on cache line boundaries
+//-----------------------------------------------------------------------------
+PacketPool::PacketPool() :
+    myNext( 0 ),
+    myAcquired( 0 ),
+    myExhausted( 0 ),
+    myHeapAllocations( 1 )
+{
+    myArena = new char[PACKET_POOL_SLOTS * PACKET_POOL_SLOT + PACKET_POOL_ALIGN - 1];
+    size_t misalign = (size_t)myArena % PACKET_POOL_ALIGN;
+    mySlots = (POOLED_PACKET *)( myArena + ( misalign == 0 ? 0 : PACKET_POOL_ALIGN - misalign ) );
+    for( int i = 0; i < PACKET_POOL_SLOTS; i++ )
+    {
+        POOLED_PACKET *slot = new( &mySlots[i] ) POOLED_PACKET;
+        slot->refs.store( 0 );
+        slot->wLength = 0;
+        slot->bID = 0;
+        slot->llTimeUs = 0;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+PacketPool::~PacketPool()
+{
+    for( int i = 0; i < PACKET_POOL_SLOTS; i++ )
+        mySlots[i].~POOLED_PACKET();
+    delete [] myArena;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: acquire()
+// Desc: Slots come back in roughly the order they went out, so looking on
+//       from the last one handed out usually finds a free one at once
+//-----------------------------------------------------------------------------
+POOLED_PACKET *PacketPool::acquire()
+{
+    for( int n = 0; n < PACKET_POOL_SLOTS; n++ )
+    {
+        POOLED_PACKET *slot = &mySlots[myNext];
+        myNext = ( myNext + 1 ) % PACKET_POOL_SLOTS;
+        // Only this thread takes slots out of the pool, so a free one stays
+        // free until we set it
+        if( slot->refs.load( std::memory_order_acquire ) == 0 )
+        {
+            slot->refs.store( 1, std::memory_order_relaxed );
+            myAcquired++;
+            return slot;
+        }
+    }
+    myExhausted++;
+    return nullptr;
+}
+
+
+//-----------------------------------------------------------------------------
+PacketQueue::PacketQueue( int id ) :
+    myID( id ),
+    myHead( 0 ),
+    myTail( 0 ),
+    myDropped( 0 )
+{
+}
+
+
+//-----------------------------------------------------------------------------
+PacketQueue::~PacketQueue()
+{
+    while( pop().isValid() )
+        ;
+}
+
+
+//-----------------------------------------------------------------------------
+bool PacketQueue::push( POOLED_PACKET *packet )
+{
+    unsigned int tail = myTail.load( std::memory_order_relaxed );
+    if( tail - myHead.load( std::memory_order_acquire ) >= PACKET_QUEUE_SIZE )
+    {
+        myDropped++;
+        return false;
+    }
+    packet->refs.fetch_add( 1, std::memory_order_relaxed );
+    myRing[tail % PACKET_QUEUE_SIZE] = packet;
+    myTail.store( tail + 1, std::memory_order_release );
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+PacketRef PacketQueue::pop()
+{
+    unsigned int head = myHead.load( std::memory_order_relaxed );
+    if( head == myTail.load( std::memory_order_acquire ) )
+        return PacketRef();
+    PacketRef ref( myRing[head % PACKET_QUEUE_SIZE] );
+    myHead.store( head + 1, std::memory_order_release );
+    return ref;
+}
+
+
+//-----------------------------------------------------------------------------
+PacketTap::PacketTap( ArRobot *robot ) :
+    myRobot( robot ),
+    myQueueCount( 0 ),
+    myPackets( 0 ),
+    myHandlerCB( this, &PacketTap::handlePacket )
+{
+    // First, so every packet is seen even if a later handler claims it
+    myRobot->lock();
+    myRobot->addPacketHandler( &myHandlerCB, ArListPos::FIRST );
+    myRobot->unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+PacketTap::~PacketTap()
+{
+    myRobot->lock();
+    myRobot->remPacketHandler( &myHandlerCB );
+    myRobot->unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+void PacketTap::addQueue( PacketQueue *queue )
+{
+    myRobot->lock();
+    if( myQueueCount < PACKET_TAP_MAX_QUEUES )
+        myQueues[myQueueCount++] = queue;
+    myRobot->unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+void PacketTap::remQueue( PacketQueue *queue )
+{
+    myRobot->lock();
+    for( int i = 0; i < myQueueCount; i++ )
+    {
+        if( myQueues[i] != queue )
+            continue;
+        myQueues[i] = myQueues[--myQueueCount];
+        break;
+    }
+    myRobot->unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: handlePacket()
+// Desc: ArRobot packet handler, with the robot locked.  One copy out of the
+//       receiver's buffer; every queue that wants the packet shares it.
+//       Never claims the packet.
+//-----------------------------------------------------------------------------
+bool PacketTap::handlePacket( ArRobotPacket *packet )
+{
+    myPackets++;
+    int id = packet->getID();
+    bool bWanted = false;
+    for( int i = 0; i < myQueueCount; i++ )
+        bWanted = bWanted || myQueues[i]->getID() < 0 || myQueues[i]->getID() == id;
+    if( !bWanted || packet->getLength() > PACKET_POOL_DATA )
+        return false;
+
+    POOLED_PACKET *slot = myPool.acquire();
+    if( slot == nullptr )
+        return false;
+    memcpy( slot->data, packet->getBuf(), packet->getLength() );
+    slot->wLength = packet->getLength();
+    slot->bID = (unsigned char)id;
+    slot->llTimeUs = MonotonicMicros();
+
+    for( int i = 0; i < myQueueCount; i++ )
+    {
+        if( myQueues[i]->getID() < 0 || myQueues[i]->getID() == id )
+            myQueues[i]->push( slot );
+    }
+    // The tap's own reference; the queues hold theirs
+    slot->refs.fetch_sub( 1, std::memory_order_acq_rel );
+    return false;
+}
@@ -0,0 +1,161 @@
+//-----------------------------------------------------------------------------
+// File: PacketPool.h
+//
+// Received robot packets shared with other threads without copying them
+// again or allocating.  ArRobot's receiver reuses one packet, so a handler
+// that wants to keep one has to copy it; PacketTap makes that one copy, into
+// a slot of a fixed pool, and hands reference-counted PacketRefs to the
+// PacketQueues of any threads that asked for them.  A slot goes back to the
+// pool when its last reference is dropped.
+//
+// Slots are raw packet bytes, not ArRobotPacket, because ArRobotPacket keeps
+// its read position inside: a reader wraps the bytes in its own
+// ArRobotPacket with setBuf() if it wants the bufTo functions.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "Aria.h"
+#include <atomic>
+
+#define PACKET_POOL_SLOTS     64
+#define PACKET_POOL_DATA     288    // largest robot packet is 258 bytes
+#define PACKET_POOL_SLOT     320    // bytes per slot, whole cache lines
+#define PACKET_POOL_ALIGN     64
+#define PACKET_QUEUE_SIZE     64    // power of two
+#define PACKET_TAP_MAX_QUEUES  4
+
+// One received packet.  Only the tap writes it, and only while it holds the
+// sole reference.
+struct POOLED_PACKET
+{
+    char              data[PACKET_POOL_DATA];   // sync bytes through checksum
+    long long         llTimeUs;                 // MonotonicMicros() when handled
+    std::atomic<int>  refs;                     // 0 while in the pool
+    unsigned short    wLength;
+    unsigned char     bID;
+    char              pad[PACKET_POOL_SLOT - PACKET_POOL_DATA - sizeof( long long ) - sizeof( std::atomic<int> ) - 3];
+};
+
+class PacketRef
+{
+public:
+    PacketRef() : myPacket( nullptr ) {}
+    // Takes over a reference the caller already holds
+    explicit PacketRef( POOLED_PACKET *packet ) : myPacket( packet ) {}
+    PacketRef( const PacketRef &other ) : myPacket( other.myPacket ) { addRef(); }
+    PacketRef &operator=( const PacketRef &other )
+    {
+        if( other.myPacket != myPacket )
+        {
+            reset();
+            myPacket = other.myPacket;
+            addRef();
+        }
+        return *this;
+    }
+    ~PacketRef() { reset(); }
+
+    void reset()
+    {
+        if( myPacket != nullptr )
+            myPacket->refs.fetch_sub( 1, std::memory_order_acq_rel );
+        myPacket = nullptr;
+    }
+
+    bool isValid() const { return myPacket != nullptr; }
+    const char *getBytes() const { return myPacket->data; }
+    unsigned short getLength() const { return myPacket->wLength; }
+    unsigned char getID() const { return myPacket->bID; }
+    long long getTimeUs() const { return myPacket->llTimeUs; }
+
+protected:
+    void addRef()
+    {
+        if( myPacket != nullptr )
+            myPacket->refs.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    POOLED_PACKET *myPacket;
+};
+
+class PacketPool
+{
+public:
+    PacketPool();
+    ~PacketPool();
+
+    // A free slot holding one reference, or nullptr if every slot is in use.
+    // One thread only (the robot's).
+    POOLED_PACKET *acquire();
+
+    // Slots handed out, times the pool was empty, and heap allocations made,
+    // which stays at the one for the slots
+    unsigned int getAcquired() const { return myAcquired; }
+    unsigned int getExhausted() const { return myExhausted; }
+    unsigned int getHeapAllocations() const { return myHeapAllocations; }
+
+protected:
+    char *myArena;
+    POOLED_PACKET *mySlots;
+    int myNext;
+    unsigned int myAcquired;
+    unsigned int myExhausted;
+    unsigned int myHeapAllocations;
+
+    // Not copyable
+    PacketPool( const PacketPool & );
+    PacketPool &operator=( const PacketPool & );
+};
+
+// Single-producer/single-consumer ring of references: the robot thread
+// pushes, one other thread pops.  A full queue drops the new packet.
+class PacketQueue
+{
+public:
+    // id of the packets wanted, or -1 for all of them
+    PacketQueue( int id = -1 );
+    ~PacketQueue();
+
+    int getID() const { return myID; }
+
+    // Producer; adds a reference
+    bool push( POOLED_PACKET *packet );
+    // Consumer; an invalid ref when empty
+    PacketRef pop();
+
+    unsigned int getDropped() const { return myDropped; }
+
+protected:
+    int myID;
+    POOLED_PACKET *myRing[PACKET_QUEUE_SIZE];
+    std::atomic<unsigned int> myHead;     // next to pop
+    char myPad[64];
+    std::atomic<unsigned int> myTail;     // next to push
+    unsigned int myDropped;
+};
+
+// ArRobot packet handler that feeds the queues from the pool
+class PacketTap
+{
+public:
+    PacketTap( ArRobot *robot );
+    ~PacketTap();
+
+    // Any thread; the queue must outlive the tap or be removed first
+    void addQueue( PacketQueue *queue );
+    void remQueue( PacketQueue *queue );
+
+    PacketPool *getPool() { return &myPool; }
+    unsigned int getPackets() const { return myPackets; }
+
+protected:
+    bool handlePacket( ArRobotPacket *packet );
+
+    ArRobot *myRobot;
+    PacketPool myPool;
+    PacketQueue *myQueues[PACKET_TAP_MAX_QUEUES];
+    int myQueueCount;
+    unsigned int myPackets;
+
+    ArRetFunctor1C<bool, PacketTap, ArRobotPacket *> myHandlerCB;
+};
@@ -0,0 +1,72 @@
+//-----------------------------------------------------------------------------
+// File: PacketRecorder.cpp
+//
+// Robot packets to a file
+//-----------------------------------------------------------------------------
+#include "PacketRecorder.h"
+
+
+//-----------------------------------------------------------------------------
+PacketRecorder::PacketRecorder( PacketTap *tap, int id ) :
+    myTap( tap ),
+    myQueue( id ),
+    myFile( nullptr ),
+    myRecords( 0 )
+{
+}
+
+
+//-----------------------------------------------------------------------------
+PacketRecorder::~PacketRecorder()
+{
+    if( getRunning() )
+    {
+        stopRunning();
+        join();
+    }
+    myTap->remQueue( &myQueue );
+    if( myFile != nullptr )
+        fclose( myFile );
+}
+
+
+//-----------------------------------------------------------------------------
+bool PacketRecorder::open( const char *fileName )
+{
+    myFile = fopen( fileName, "wb" );
+    if( myFile == nullptr )
+        return false;
+    myTap->addQueue( &myQueue );
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: runThread()
+// Desc: Drains the queue; the slot of each packet goes back to the pool as
+//       soon as it is written
+//-----------------------------------------------------------------------------
+void *PacketRecorder::runThread( void * )
+{
+    threadStarted();
+
+    while( getRunning() )
+    {
+        PacketRef packet = myQueue.pop();
+        if( !packet.isValid() )
+        {
+            fflush( myFile );
+            ArUtil::sleep( PACKET_RECORDER_IDLE_MS );
+            continue;
+        }
+        long long llTimeUs = packet.getTimeUs();
+        unsigned short wLength = packet.getLength();
+        fwrite( &llTimeUs, sizeof( llTimeUs ), 1, myFile );
+        fwrite( &wLength, sizeof( wLength ), 1, myFile );
+        fwrite( packet.getBytes(), 1, wLength, myFile );
+        myRecords++;
+    }
+
+    threadFinished();
+    return nullptr;
+}
@@ -0,0 +1,38 @@
+//-----------------------------------------------------------------------------
+// File: PacketRecorder.h
+//
+// Writes the robot's packets to a file from its own thread, so the robot
+// cycle never waits on the disk.  Packets come from a PacketTap queue; a
+// record is the receive time, the length and the raw packet:
+//
+//     long long llTimeUs   unsigned short wLength   char data[wLength]
+//
+// little endian, as written on x86.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "PacketPool.h"
+#include <stdio.h>
+
+#define PACKET_RECORDER_IDLE_MS 10   // sleep when the queue is empty
+
+class PacketRecorder : public ArASyncTask
+{
+public:
+    // id of the packets to record, -1 for all
+    PacketRecorder( PacketTap *tap, int id = -1 );
+    // Stops the thread and closes the file
+    virtual ~PacketRecorder();
+
+    bool open( const char *fileName );
+    virtual void *runThread( void *arg );
+
+    unsigned int getRecords() const { return myRecords; }
+    unsigned int getDropped() const { return myQueue.getDropped(); }
+
+protected:
+    PacketTap *myTap;
+    PacketQueue myQueue;
+    FILE *myFile;
+    unsigned int myRecords;
+};
@@ -0,0 +1,138 @@
+//-----------------------------------------------------------------------------
+// File: PadBinding.cpp
+//
+// Which pads drive which robot
+//-----------------------------------------------------------------------------
+#include "PadBinding.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+//-----------------------------------------------------------------------------
+PadBinding::PadBinding( ArRobot *robot, LatestValueSlot<CONTROLLER_SNAPSHOT> *slot, unsigned int padMask ) :
+    myRobot( robot ),
+    mySlot( slot ),
+    myPadMask( padMask ),
+    myScheduler( robot ),
+    myDriveThread( &myScheduler, slot ),
+    myDecelForwards( nullptr ),
+    myDecelBackwards( nullptr ),
+    myLimiterFar( nullptr ),
+    myRatioInput( nullptr ),
+    myRatioInputGamepad( nullptr )
+{
+    myDriveThread.setPadMask( padMask );
+}
+
+
+//-----------------------------------------------------------------------------
+PadBinding::~PadBinding()
+{
+    if( myDriveThread.getRunning() )
+    {
+        myDriveThread.stopRunning();
+        myDriveThread.join();
+    }
+
+    if( myRatioInput != nullptr )
+    {
+        myRobot->lock();
+        myRobot->remAction( myDecelForwards );
+        myRobot->remAction( myDecelBackwards );
+        myRobot->remAction( myLimiterFar );
+        myRobot->remAction( myRatioInput );
+        myRobot->unlock();
+        delete myRatioInputGamepad;
+        delete myRatioInput;
+        delete myLimiterFar;
+        delete myDecelBackwards;
+        delete myDecelForwards;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: driveWithActions()
+// Desc: The limiters sit above the ratio input, so whatever the pads ask for
+//       is slowed down and stopped short of obstacles.  Direct motion from
+//       startup is cleared, or it would keep overriding the actions.
+//-----------------------------------------------------------------------------
+void PadBinding::driveWithActions( double maxVel, double maxRotVel )
+{
+    if( myRatioInput != nullptr )
+        return;
+
+    myDecelForwards = new ArActionDeceleratingLimiter( "decelerating limiter forwards", ArActionDeceleratingLimiter::FORWARDS );
+    myDecelBackwards = new ArActionDeceleratingLimiter( "decelerating limiter backwards", ArActionDeceleratingLimiter::BACKWARDS );
+    myLimiterFar = new ArActionLimiterForwards( "speed limiter far", 300, 1100, 400 );
+    myRatioInput = new ArActionRatioInput( "pad ratio input" );
+    myRatioInput->setParameters( maxVel, maxVel, maxRotVel, maxRotVel, maxRotVel );
+    myRatioInputGamepad = new RatioInputGamepad( myRatioInput, mySlot, myPadMask );
+
+    myRobot->lock();
+    myRobot->addAction( myDecelForwards, 100 );
+    myRobot->addAction( myDecelBackwards, 99 );
+    myRobot->addAction( myLimiterFar, 90 );
+    myRobot->addAction( myRatioInput, 50 );
+    myRobot->clearDirectMotion();
+    myRobot->unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+PadRobot::PadRobot( int slot ) :
+    mySlot( slot )
+{
+}
+
+
+//-----------------------------------------------------------------------------
+PadRobot::~PadRobot()
+{
+    if( myRobot.isRunning() )
+    {
+        myRobot.stopRunning();
+        myRobot.waitForRunExit();
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: connect()
+// Desc: Connect, start the robot's own task loop and enable the motors
+//-----------------------------------------------------------------------------
+bool PadRobot::connect( const char *hostPort )
+{
+    char host[256];
+    int port = 8101;
+    strncpy( host, hostPort, sizeof( host ) - 1 );
+    host[sizeof( host ) - 1] = '\0';
+    char *colon = strrchr( host, ':' );
+    if( colon != nullptr )
+    {
+        *colon = '\0';
+        port = atoi( colon + 1 );
+    }
+
+    int ret = myConn.open( host, port );
+    if( ret != 0 )
+    {
+        ArLog::log( ArLog::Terse, "Controller %d: could not connect to %s:%d: %s",
+                    mySlot, host, port, myConn.getOpenMessage( ret ) );
+        return false;
+    }
+
+    myRobot.setDeviceConnection( &myConn );
+    if( !myRobot.blockingConnect() )
+    {
+        ArLog::log( ArLog::Terse, "Controller %d: no robot at %s:%d", mySlot, host, port );
+        return false;
+    }
+
+    myRobot.runAsync( true );
+    myRobot.lock();
+    myRobot.enableMotors();
+    myRobot.unlock();
+    ArLog::log( ArLog::Normal, "Controller %d drives the robot at %s:%d", mySlot, host, port );
+    return true;
+}
@@ -0,0 +1,67 @@
+//-----------------------------------------------------------------------------
+// File: PadBinding.h
+//
+// Which pads drive which robot.  A PadBinding is one robot's command path:
+// its own CommandScheduler and RobotDriveThread fed from its own input slot,
+// so a binding never waits on another binding's thread or robot lock.
+// PadRobot is an extra robot, reached over TCP, for a pad that should not
+// share the main one.
+//
+// A binding can instead drive through ARIA's action resolver: the pads feed
+// an ArActionRatioInput under a stack of limiting actions, and the drive
+// thread is not started.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "RobotDrive.h"
+#include "CommandScheduler.h"
+#include "RatioInputGamepad.h"
+#include "Aria.h"
+
+class PadBinding
+{
+public:
+    // robot must be connected and outlive the binding
+    PadBinding( ArRobot *robot, LatestValueSlot<CONTROLLER_SNAPSHOT> *slot, unsigned int padMask );
+    // Stops the drive thread, takes the scheduler and any actions off the robot
+    ~PadBinding();
+
+    // Drive through actions instead of the drive thread; call instead of
+    // starting the drive thread.  Velocities are at full stick deflection.
+    void driveWithActions( double maxVel, double maxRotVel );
+    bool isDrivingWithActions() const { return myRatioInput != nullptr; }
+
+    RobotDriveThread *getDriveThread() { return &myDriveThread; }
+    CommandScheduler *getScheduler() { return &myScheduler; }
+    unsigned int getPadMask() const { return myPadMask; }
+
+protected:
+    ArRobot *myRobot;
+    LatestValueSlot<CONTROLLER_SNAPSHOT> *mySlot;
+    unsigned int myPadMask;
+    CommandScheduler myScheduler;
+    RobotDriveThread myDriveThread;
+
+    // Only with driveWithActions()
+    ArActionDeceleratingLimiter *myDecelForwards;
+    ArActionDeceleratingLimiter *myDecelBackwards;
+    ArActionLimiterForwards *myLimiterFar;
+    ArActionRatioInput *myRatioInput;
+    RatioInputGamepad *myRatioInputGamepad;
+};
+
+class PadRobot
+{
+public:
+    PadRobot( int slot );
+    ~PadRobot();
+
+    // "host" or "host:port", port 8101 by default (MobileSim's first robot)
+    bool connect( const char *hostPort );
+    ArRobot *getRobot() { return &myRobot; }
+
+protected:
+    int mySlot;
+    ArTcpConnection myConn;
+    ArRobot myRobot;
+};
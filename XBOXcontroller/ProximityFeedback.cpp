@@ -0,0 +1,135 @@
+//-----------------------------------------------------------------------------
+// File: ProximityFeedback.cpp
+//
+// Rumble feedback from range-device proximity
+//-----------------------------------------------------------------------------
+#include "ProximityFeedback.h"
+#include <math.h>
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+//-----------------------------------------------------------------------------
+ProximityFeedback::ProximityFeedback( ArRobot *robot, GamepadSource *source, unsigned int padMask ) :
+    myRobot( robot ),
+    mySource( source ),
+    myPadMask( padMask ),
+    myUpdates( 0 ),
+    myStrength( 0 ),
+    myConnectedMask( 0 ),
+    myTaskCB( this, &ProximityFeedback::task ),
+    myConnectCB( this, &ProximityFeedback::handleConnect ),
+    myDisconnectCB( this, &ProximityFeedback::handleDisconnect )
+{
+    mySource->addConnectCB( &myConnectCB );
+    mySource->addDisconnectCB( &myDisconnectCB );
+    myRobot->lock();
+    myRobot->addUserTask( "ProximityFeedback", 60, &myTaskCB );
+    myRobot->unlock();
+    setThreadName( "ProximityFeedback" );
+}
+
+
+//-----------------------------------------------------------------------------
+ProximityFeedback::~ProximityFeedback()
+{
+    mySource->remConnectCB( &myConnectCB );
+    mySource->remDisconnectCB( &myDisconnectCB );
+    myRobot->lock();
+    myRobot->remUserTask( &myTaskCB );
+    myRobot->unlock();
+    if( getRunning() )
+    {
+        stopRunning();
+        join();
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: task()
+// Desc: ArRobot user task.  Look for the closest reading in a cone ahead of
+//       the robot, or behind it when reversing, and turn the clearance past
+//       the robot's radius into a rumble strength.
+//-----------------------------------------------------------------------------
+void ProximityFeedback::task()
+{
+    double vel = myRobot->getVel();
+    if( fabs( vel ) < FEEDBACK_MIN_VEL )
+    {
+        myStrength.store( 0 );
+        return;
+    }
+
+    double startAngle = vel > 0 ? -FEEDBACK_CONE_DEG : 180 - FEEDBACK_CONE_DEG;
+    double endAngle = vel > 0 ? FEEDBACK_CONE_DEG : -180 + FEEDBACK_CONE_DEG;
+    double clearance = myRobot->checkRangeDevicesCurrentPolar( startAngle, endAngle ) - myRobot->getRobotRadius();
+
+    double closeness = ( FEEDBACK_FAR_MM - clearance ) / ( FEEDBACK_FAR_MM - FEEDBACK_NEAR_MM );
+    if( closeness < 0 ) closeness = 0;
+    if( closeness > 1 ) closeness = 1;
+    myStrength.store( (unsigned int)( closeness * 65535 ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: runThread()
+// Desc: Send the strength to every connected pad, at most FEEDBACK_RATE_HZ
+//       and only when it changed noticeably or needs refreshing.  The low
+//       motor follows the strength; the high one only joins in when close,
+//       so the buzz gets sharper near an obstacle.
+//-----------------------------------------------------------------------------
+void *ProximityFeedback::runThread( void * )
+{
+#ifdef WIN32
+    SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL );
+#else
+    setpriority( PRIO_PROCESS, (id_t)syscall( SYS_gettid ), 10 );
+#endif
+
+    threadStarted();
+
+    unsigned int sent[MAX_CONTROLLERS] = { 0 };
+    ArTime lastSent[MAX_CONTROLLERS];
+
+    while( getRunning() )
+    {
+        unsigned int strength = myStrength.load();
+        unsigned int pads = myConnectedMask.load() & myPadMask;
+        for( int i = 0; i < MAX_CONTROLLERS; i++ )
+        {
+            if( !( pads & ( 1u << i ) ) )
+            {
+                sent[i] = 0;
+                continue;
+            }
+            unsigned int diff = strength > sent[i] ? strength - sent[i] : sent[i] - strength;
+            bool bChanged = diff >= FEEDBACK_STEP || ( diff > 0 && ( strength == 0 || sent[i] == 0 ) );
+            bool bRefresh = strength != 0 && lastSent[i].mSecSince() >= FEEDBACK_REFRESH_MS;
+            if( !bChanged && !bRefresh )
+                continue;
+
+            mySource->setRumble( i, (unsigned short)strength, (unsigned short)( strength * strength / 65535 ) );
+            sent[i] = strength;
+            lastSent[i].setToNow();
+            myUpdates++;
+        }
+        ArUtil::sleep( 1000 / FEEDBACK_RATE_HZ );
+    }
+
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        if( sent[i] != 0 )
+            mySource->setRumble( i, 0, 0 );
+    }
+
+    threadFinished();
+    return nullptr;
+}
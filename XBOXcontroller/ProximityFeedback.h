@@ -0,0 +1,53 @@
+//-----------------------------------------------------------------------------
+// File: ProximityFeedback.h
+//
+// Rumbles the pads as the robot closes in on something in the direction it
+// is driving.  The clearance is measured from a robot user task, so it uses
+// the range devices' current readings once per robot cycle; the rumble is
+// sent from a separate low-priority thread at a limited rate, because
+// XInputSetState can take a while and must never hold up input or the robot.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "Gamepad.h"
+#include "Aria.h"
+#include <atomic>
+
+#define FEEDBACK_RATE_HZ      20    // rumble updates per second, at most
+#define FEEDBACK_REFRESH_MS  250    // an unchanged rumble is resent this often
+#define FEEDBACK_STEP       2048    // smaller changes in strength are not sent
+#define FEEDBACK_NEAR_MM     250    // full rumble at this clearance
+#define FEEDBACK_FAR_MM     1500    // no rumble beyond this clearance
+#define FEEDBACK_MIN_VEL      20    // mm/s; slower than this is not driving anywhere
+#define FEEDBACK_CONE_DEG     30    // half-width of the cone checked in the drive direction
+
+class ProximityFeedback : public ArASyncTask
+{
+public:
+    // Rumbles the pads in padMask; create before the input thread starts so
+    // the connect callbacks see every pad
+    ProximityFeedback( ArRobot *robot, GamepadSource *source, unsigned int padMask );
+    // Stops the thread and the rumble
+    virtual ~ProximityFeedback();
+
+    virtual void *runThread( void *arg );
+
+    // Calls to setRumble so far
+    unsigned int getUpdates() const { return myUpdates; }
+
+protected:
+    void task();
+    void handleConnect( int slot ) { myConnectedMask.fetch_or( 1u << slot ); }
+    void handleDisconnect( int slot ) { myConnectedMask.fetch_and( ~( 1u << slot ) ); }
+
+    ArRobot *myRobot;
+    GamepadSource *mySource;
+    unsigned int myPadMask;
+    unsigned int myUpdates;
+    std::atomic<unsigned int> myStrength;      // 0 - 65535, written by the robot task
+    std::atomic<unsigned int> myConnectedMask;
+
+    ArFunctorC<ProximityFeedback> myTaskCB;
+    ArFunctor1C<ProximityFeedback, int> myConnectCB;
+    ArFunctor1C<ProximityFeedback, int> myDisconnectCB;
+};
@@ -0,0 +1,70 @@
+//-----------------------------------------------------------------------------
+// File: RatioInputGamepad.cpp
+//
+// Pads as an ArActionRatioInput source
+//-----------------------------------------------------------------------------
+#include "RatioInputGamepad.h"
+
+
+//-----------------------------------------------------------------------------
+RatioInputGamepad::RatioInputGamepad( ArActionRatioInput *input, LatestValueSlot<CONTROLLER_SNAPSHOT> *slot,
+                                      unsigned int padMask, int priority, int holdMs ) :
+    myInput( input ),
+    mySlot( slot ),
+    myPadMask( padMask ),
+    myHoldMs( holdMs ),
+    myHaveSnapshot( false ),
+    myDriver( -1 ),
+    myFireCB( this, &RatioInputGamepad::fireCallback )
+{
+    myInput->addFireCallback( priority, &myFireCB );
+}
+
+
+//-----------------------------------------------------------------------------
+RatioInputGamepad::~RatioInputGamepad()
+{
+    myInput->remFireCallback( &myFireCB );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: fireCallback()
+// Desc: Called by the action as it fires, on the robot thread.  Takes the
+//       newest snapshot if there is one and keeps using the last one until
+//       the input thread has been quiet for longer than myHoldMs.
+//-----------------------------------------------------------------------------
+void RatioInputGamepad::fireCallback()
+{
+    const CONTROLLER_SNAPSHOT *snapshot = mySlot->consume();
+    if( snapshot != nullptr )
+    {
+        myHaveSnapshot = true;
+        myLastSnapshot.setToNow();
+    }
+    else if( myHaveSnapshot && myLastSnapshot.mSecSince() <= myHoldMs )
+    {
+        snapshot = mySlot->peek();
+    }
+
+    myDriver = -1;
+    if( snapshot == nullptr )
+    {
+        myInput->setRatios( 0, 0, 100 );
+        return;
+    }
+
+    const CONTROLLER_AXES &axes = snapshot->axes;
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        if( !( myPadMask & ( 1 << i ) ) || !snapshot->pads[i].bConnected )
+            continue;
+        if( axes.fThumbLX[i] == 0 && axes.fThumbLY[i] == 0 )
+            continue;
+        myDriver = i;
+        // Stick right is clockwise, a negative rotation ratio
+        myInput->setRatios( axes.fThumbLY[i] * 100.0, -axes.fThumbLX[i] * 100.0, 100 );
+        return;
+    }
+    myInput->setRatios( 0, 0, 100 );
+}
@@ -0,0 +1,46 @@
+//-----------------------------------------------------------------------------
+// File: RatioInputGamepad.h
+//
+// Drives an ArActionRatioInput from the pads, the way ArRatioInputJoydrive
+// does from a PC joystick.  The ratios are set from a fire callback, so they
+// are refreshed once per robot cycle inside action resolution, and limiting
+// actions at a higher priority (ArActionDeceleratingLimiter,
+// ArActionLimiterForwards, ...) get to cut them down before they reach the
+// robot.  This replaces the scheduler's direct motion commands, which
+// bypass the resolver entirely.
+//
+// The left stick drives, arcade style: Y is the translation ratio, X the
+// rotation ratio.  The first connected pad in the mask with the stick off
+// center drives; with every stick centered the ratios are 0 and the robot
+// is held stopped.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "ControllerInput.h"
+#include "LatestValueSlot.h"
+#include "CommandScheduler.h"
+#include "Aria.h"
+
+class RatioInputGamepad
+{
+public:
+    // Reads snapshots from slot, which nothing else may consume
+    RatioInputGamepad( ArActionRatioInput *input, LatestValueSlot<CONTROLLER_SNAPSHOT> *slot,
+                       unsigned int padMask, int priority = 50, int holdMs = COMMAND_HOLD_MS );
+    ~RatioInputGamepad();
+
+    // Pad that set the ratios last cycle, -1 for none
+    int getDriver() const { return myDriver; }
+
+protected:
+    void fireCallback();
+
+    ArActionRatioInput *myInput;
+    LatestValueSlot<CONTROLLER_SNAPSHOT> *mySlot;
+    unsigned int myPadMask;
+    int myHoldMs;
+    bool myHaveSnapshot;
+    ArTime myLastSnapshot;
+    int myDriver;
+    ArFunctorC<RatioInputGamepad> myFireCB;
+};
@@ -0,0 +1,356 @@
+//-----------------------------------------------------------------------------
+// File: RobotDrive.cpp
+//
+// Turns controller snapshots into motion targets
+//-----------------------------------------------------------------------------
+#include "RobotDrive.h"
+#include "HighResClock.h"
+#include <math.h>
+
+#define CONS1 (1.05/2)
+#define CONS2 (1.732/2)
+
+static const BUTTON_RULE DRIVE_BUTTON_RULES[] =
+{
+    // Only the press counts, not holding the button down
+    { DRIVE_HANDOFF_BUTTON, BUTTON_PRESS, 0, DRIVE_ACTION_HANDOFF },
+};
+
+
+//-----------------------------------------------------------------------------
+RobotDriveThread::RobotDriveThread( CommandScheduler *scheduler, LatestValueSlot<CONTROLLER_SNAPSHOT> *slot ) :
+    myScheduler( scheduler ),
+    mySlot( slot ),
+    myPadMask( ( 1 << MAX_CONTROLLERS ) - 1 ),
+    myArbitration( ARBITRATE_OWNER ),
+    myHeadingMode( HEADING_SERVO ),
+    myOwner( -1 ),
+    myHandoffs( 0 ),
+    myTriggerGain( TRIGGER_ROT_GAIN ),
+    myTriggerSlew( TRIGGER_ROT_SLEW ),
+    myLastShapingGeneration( 0 ),
+    myLastEasyRotate( false ),
+    myHaveLast( false ),
+    myEasyRotate( true ),
+    myHandoffPending( 0 ),
+    myHandoffCB( this, &RobotDriveThread::handleHandoff ),
+    mySkippedSnapshots( 0 ),
+    mySnapshots( 0 )
+{
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        myLastPacket[i] = 0;
+        myLastConnected[i] = false;
+        myTriggerRot[i] = 0;
+        myTriggerUs[i] = 0;
+    }
+    myButtons.addRules( DRIVE_BUTTON_RULES, sizeof( DRIVE_BUTTON_RULES ) / sizeof( DRIVE_BUTTON_RULES[0] ) );
+    myButtons.setAction( DRIVE_ACTION_HANDOFF, &myHandoffCB );
+    setThreadName( "RobotDriveThread" );
+}
+
+
+//-----------------------------------------------------------------------------
+RobotDriveThread::~RobotDriveThread()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: runThread()
+// Desc: Drive from the newest snapshot.  Snapshots that arrive while we are
+//       still busy with the previous one are skipped, never queued.  Only
+//       pads whose packet number moved, or whose trigger rotation is still
+//       ramping, are mapped again.
+//-----------------------------------------------------------------------------
+void *RobotDriveThread::runThread( void * )
+{
+    threadStarted();
+
+    while( getRunning() )
+    {
+        const CONTROLLER_SNAPSHOT *snapshot = mySlot->consume();
+        if( snapshot == nullptr )
+        {
+            ArUtil::sleep( 1 );
+            continue;
+        }
+
+        mySnapshots++;
+
+        // A different dead zone or rotate setting changes every pad's
+        // output without changing its packet number
+        bool bEasyRotate = myEasyRotate.load();
+        bool bAll = !myHaveLast ||
+                    snapshot->uShapingGeneration != myLastShapingGeneration ||
+                    bEasyRotate != myLastEasyRotate;
+        myHaveLast = true;
+        myLastShapingGeneration = snapshot->uShapingGeneration;
+        myLastEasyRotate = bEasyRotate;
+
+        bool bChanged = false;
+        bool bPadChanged[MAX_CONTROLLERS];
+        bool bHandoff[MAX_CONTROLLERS];
+        long long llNowUs = MonotonicMicros();
+        myHandoffPending = 0;
+        for( int i = 0; i < MAX_CONTROLLERS; i++ )
+        {
+            const GAMEPAD_STATE &pad = snapshot->pads[i];
+            bPadChanged[i] = false;
+            bHandoff[i] = false;
+            if( !( myPadMask & ( 1 << i ) ) )
+                continue;
+            // Button rules see every snapshot, so holds and repeats keep time
+            myButtons.update( i, pad.bConnected ? pad.wButtons : 0, llNowUs );
+            bool bRamping = updateTriggerRotation( *snapshot, i );
+            if( !bAll && !bRamping && pad.bConnected == myLastConnected[i] &&
+                pad.uPacket == myLastPacket[i] )
+                continue;
+
+            bHandoff[i] = ( myHandoffPending & ( 1u << i ) ) != 0;
+            myLastConnected[i] = pad.bConnected;
+            myLastPacket[i] = pad.uPacket;
+            myPadIntent[i] = MOTION_TARGET();
+            if( pad.bConnected )
+                addPadIntent( *snapshot, i, &myPadIntent[i], bEasyRotate );
+            myPadIntent[i].llInputUs = pad.llTimeUs;
+            bPadChanged[i] = true;
+            bChanged = true;
+        }
+        if( bChanged && myArbitration == ARBITRATE_OWNER && !arbitrate( bPadChanged, bHandoff ) )
+        {
+            // Only pads without the robot changed
+            bChanged = false;
+        }
+
+        // Every snapshot refreshes the scheduler's deadline, so it only
+        // runs out if input stops arriving altogether
+        if( !bChanged )
+        {
+            mySkippedSnapshots++;
+            myScheduler->keepAlive();
+            continue;
+        }
+
+        MOTION_TARGET target;
+        if( myArbitration == ARBITRATE_OWNER )
+        {
+            if( myOwner >= 0 )
+                target = myPadIntent[myOwner];
+        }
+        else
+        {
+            for( int i = 0; i < MAX_CONTROLLERS; i++ )
+            {
+                if( myPadMask & ( 1 << i ) )
+                    target.overlay( myPadIntent[i] );
+            }
+        }
+        myScheduler->submit( target );
+    }
+
+    threadFinished();
+    return nullptr;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: updateTriggerRotation()
+// Desc: Move pad i's trigger rotation toward ( left - right ) * gain by at
+//       most the slew rate times the time since the last step, in
+//       whole deg/s.  Once it arrives it stops changing, so a held trigger
+//       costs no more submits.  Letting go, START or a disconnect stop it
+//       at once.  Returns true if the value changed.
+//-----------------------------------------------------------------------------
+bool RobotDriveThread::updateTriggerRotation( const CONTROLLER_SNAPSHOT &snapshot, int i )
+{
+    const GAMEPAD_STATE &pad = snapshot.pads[i];
+    double previous = myTriggerRot[i];
+    // Timed here rather than by the pad: a backend that stamps events
+    // leaves an unchanged pad's time behind
+    long long llNowUs = MonotonicMicros();
+    long long llLastUs = myTriggerUs[i];
+    myTriggerUs[i] = llNowUs;
+
+    double desired = 0;
+    if( pad.bConnected && !( pad.wButtons & GAMEPAD_START ) )
+        desired = floor( ( snapshot.axes.fLeftTrigger[i] - snapshot.axes.fRightTrigger[i] ) * myTriggerGain + 0.5 );
+
+    if( desired == 0 || myTriggerSlew <= 0 || llLastUs == 0 )
+    {
+        myTriggerRot[i] = desired;
+        return desired != previous;
+    }
+
+    double dt = ( llNowUs - llLastUs ) / 1000000.0;
+    if( dt < 0 ) dt = 0;
+    if( dt > 0.1 ) dt = 0.1;
+    double step = myTriggerSlew * dt;
+    double value = previous;
+    if( desired > value )
+        value = desired - value <= step ? desired : value + step;
+    else if( desired < value )
+        value = value - desired <= step ? desired : value - step;
+    // Whole deg/s, but never stuck short of the target by rounding
+    double rounded = floor( value + 0.5 );
+    if( rounded == previous && value != previous )
+        rounded = desired > previous ? previous + 1 : previous - 1;
+    myTriggerRot[i] = rounded;
+    return rounded != previous;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: arbitrate()
+// Desc: Decide which pad owns the robot after some pads changed.  A handoff
+//       press takes the robot; when the owner disconnects the lowest
+//       connected pad gets it.  Returns true if the target must be submitted
+//       again, because the owner changed or its input did.
+//-----------------------------------------------------------------------------
+bool RobotDriveThread::arbitrate( const bool bPadChanged[MAX_CONTROLLERS], const bool bHandoff[MAX_CONTROLLERS] )
+{
+    int owner = myOwner;
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        if( bHandoff[i] )
+            owner = i;
+    }
+    if( owner < 0 || !myLastConnected[owner] )
+    {
+        owner = -1;
+        for( int i = 0; i < MAX_CONTROLLERS && owner < 0; i++ )
+        {
+            if( ( myPadMask & ( 1 << i ) ) && myLastConnected[i] )
+                owner = i;
+        }
+    }
+
+    if( owner == myOwner )
+        return owner >= 0 && bPadChanged[owner];
+
+    if( owner >= 0 )
+        ArLog::log( ArLog::Normal, "Controller %d has the robot", owner );
+    myOwner = owner;
+    myHandoffs++;
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: addPadIntent()
+// Desc: Fold one controller's input into its target.  Later inputs override
+//       earlier ones, in the same order the old pulse code issued them.
+//-----------------------------------------------------------------------------
+void RobotDriveThread::addPadIntent( const CONTROLLER_SNAPSHOT &snapshot, int i, MOTION_TARGET *target, bool bEasyRotate )
+{
+    const CONTROLLER_AXES &axes = snapshot.axes;
+    unsigned short wButtons = snapshot.pads[i].wButtons;
+
+    //start鍵當作reset鍵
+    if (wButtons & GAMEPAD_START) {
+        target->eTrans = MOTION_TARGET::TRANS_VEL;
+        target->dVel = 0;
+        target->eRot = MOTION_TARGET::ROT_VEL;
+        target->dRotVel = 0;
+        return;
+    }
+
+    //change the ArRobot object's rotating velocity by 板機, left is counter-clockwise
+    if (myTriggerRot[i] != 0) {
+        target->eRot = MOTION_TARGET::ROT_VEL;
+        target->dRotVel = myTriggerRot[i];
+    }
+
+    //change the ArRobot object's velocity by 方向鍵
+    if (wButtons & GAMEPAD_DPAD_UP) {
+        target->eTrans = MOTION_TARGET::TRANS_VEL;
+        target->dVel = 250;
+    }
+    else if (wButtons & GAMEPAD_DPAD_DOWN) {
+        target->eTrans = MOTION_TARGET::TRANS_VEL;
+        target->dVel = -250;
+    }
+    else if (wButtons & GAMEPAD_DPAD_LEFT) {
+        target->eRot = MOTION_TARGET::ROT_VEL;
+        target->dRotVel = 210;
+    }
+    else if (wButtons & GAMEPAD_DPAD_RIGHT) {
+        target->eRot = MOTION_TARGET::ROT_VEL;
+        target->dRotVel = -210;
+    }
+
+    //change the ArRobot object's velocity by 左搖桿
+    float LX = axes.fThumbLX[i];
+    float LY = axes.fThumbLY[i];
+    if (myStickMapper.getMode() == STICK_TANK) {
+        double left, right;
+        myStickMapper.mapTank(LX, LY, &left, &right);
+        if (left != 0 || right != 0) {
+            target->eTrans = MOTION_TARGET::TRANS_VEL2;
+            target->dLeftVel = left;
+            target->dRightVel = right;
+        }
+    }
+    else {
+        double vel, rotVel;
+        myStickMapper.mapArcade(LX, LY, &vel, &rotVel);
+        if (vel != 0) {
+            target->eTrans = MOTION_TARGET::TRANS_VEL;
+            target->dVel = vel;
+        }
+        if (rotVel != 0) {
+            target->eRot = MOTION_TARGET::ROT_VEL;
+            target->dRotVel = rotVel;
+        }
+    }
+
+    //change the ArRobot object's heading by 右搖桿
+    //servo: stick up is heading 0 (the heading at connect), left is +90
+    if (bEasyRotate && myHeadingMode == HEADING_SERVO) {
+        double RX = axes.fThumbRX[i];
+        double RY = axes.fThumbRY[i];
+        if (RX != 0 || RY != 0) {
+            target->eRot = MOTION_TARGET::ROT_HEADING;
+            target->dHeading = ArMath::radToDeg(atan2(-RX, RY));
+        }
+    }
+    else if (bEasyRotate) {
+        double RX = axes.fThumbRX[i];
+        double RY = axes.fThumbRY[i];
+        double cosine = RX / (sqrt(pow(RX, 2) + pow(RY, 2)));
+        double delta = 0;
+        bool bStick = true;
+        if (RY > 0 && RX > 0) {
+            //第一象限
+            if (cosine > CONS2)         delta = -90;    //0~30度
+            else if (cosine < CONS1)    delta = 0;      //60~90度
+            else                        delta = -45;    //30~60度
+        }
+        else if (RY > 0 && RX < 0) {
+            //第二象限
+            if (cosine < -CONS2)        delta = 90;     //150~180度
+            else if (cosine > -CONS1)   delta = 0;      //90~120度
+            else                        delta = 45;     //120~150度
+        }
+        else if (RY < 0 && RX < 0) {
+            //第三象限
+            if (cosine < -CONS2)        delta = 90;     //180~210度
+            else if (cosine > -CONS1)   delta = 180;    //240~270度
+            else                        delta = 135;    //210~240度
+        }
+        else if (RY < 0 && RX > 0) {
+            //第四象限
+            if (cosine > CONS2)         delta = -90;    //330~360度
+            else if (cosine < CONS1)    delta = -180;   //270~300度
+            else                        delta = -135;   //300~330度
+        }
+        else {
+            bStick = false;
+        }
+
+        if (bStick) {
+            target->eRot = MOTION_TARGET::ROT_DELTA_HEADING;
+            target->dDeltaHeading = delta;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+//-----------------------------------------------------------------------------
+// File: RobotDrive.h
+//
+// Turns controller snapshots into motion targets for the CommandScheduler.
+// Runs on its own thread and takes the newest snapshot from the input
+// thread's drive slot.  Nothing here locks the robot or sleeps.
+//
+// Each thread drives one robot from the pads in its mask.  When several pads
+// share a robot, one of them owns it and the others are ignored until one
+// presses the handoff button; pads bound to different robots have their own
+// threads and schedulers, so they never wait on each other.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "ControllerInput.h"
+#include "LatestValueSlot.h"
+#include "CommandScheduler.h"
+#include "StickMapping.h"
+#include "ButtonBindings.h"
+#include "Aria.h"
+
+#define DRIVE_HANDOFF_BUTTON GAMEPAD_BACK   // takes the robot from the pad that has it
+#define DRIVE_ACTION_HANDOFF 0               // button action the drive thread binds itself
+#define DRIVE_ACTION_FIRST_FREE 1            // first button action left for the application
+#define TRIGGER_ROT_GAIN 100.0   // deg/s of rotation at a fully pulled trigger
+#define TRIGGER_ROT_SLEW 300.0   // deg/s per second the trigger rotation may change by
+
+enum HEADING_MODE
+{
+    HEADING_SERVO,     // right stick direction is the absolute heading to hold
+    HEADING_STEPS      // right stick turns by 45 degree steps (setDeltaHeading)
+};
+
+enum DRIVE_ARBITRATION
+{
+    ARBITRATE_OWNER,   // one pad drives; DRIVE_HANDOFF_BUTTON takes over
+    ARBITRATE_MERGE    // every pad's input overlaid, in slot order
+};
+
+class RobotDriveThread : public ArASyncTask
+{
+public:
+    RobotDriveThread( CommandScheduler *scheduler, LatestValueSlot<CONTROLLER_SNAPSHOT> *slot );
+    virtual ~RobotDriveThread();
+
+    virtual void *runThread( void *arg );
+
+    // Configure before runAsync()
+    StickMapper *getStickMapper() { return &myStickMapper; }
+    // Bit i set means pad i drives this robot
+    void setPadMask( unsigned int mask ) { myPadMask = mask; }
+    void setArbitration( DRIVE_ARBITRATION arbitration ) { myArbitration = arbitration; }
+    // Right stick turns the robot at all; any thread
+    void setEasyRotate( bool bOn ) { myEasyRotate.store( bOn ); }
+    // How the right stick turns the robot; before runAsync()
+    void setHeadingMode( HEADING_MODE mode ) { myHeadingMode = mode; }
+    // Button rules run on this thread for this thread's pads; add rules and
+    // actions from DRIVE_ACTION_FIRST_FREE on, before runAsync()
+    ButtonBindings *getButtonBindings() { return &myButtons; }
+    // Trigger rotation at full pull (deg/s) and how fast it may change
+    // (deg/s per second, 0 for no limit); before runAsync()
+    void setTriggerRotation( double gain, double slew ) { myTriggerGain = gain; myTriggerSlew = slew; }
+
+    // Pad that has the robot under ARBITRATE_OWNER, -1 for none
+    int getOwner() const { return myOwner; }
+    unsigned int getHandoffs() const { return myHandoffs; }
+
+    // Snapshots in which no controller changed, so nothing was recomputed
+    unsigned int getSkippedSnapshots() const { return mySkippedSnapshots; }
+    unsigned int getSnapshots() const { return mySnapshots; }
+
+protected:
+    void addPadIntent( const CONTROLLER_SNAPSHOT &snapshot, int i, MOTION_TARGET *target, bool bEasyRotate );
+    bool arbitrate( const bool bPadChanged[MAX_CONTROLLERS], const bool bHandoff[MAX_CONTROLLERS] );
+    bool updateTriggerRotation( const CONTROLLER_SNAPSHOT &snapshot, int i );
+    void handleHandoff( int slot ) { myHandoffPending |= 1u << slot; }
+
+    CommandScheduler *myScheduler;
+    StickMapper myStickMapper;
+    LatestValueSlot<CONTROLLER_SNAPSHOT> *mySlot;
+    unsigned int myPadMask;
+    DRIVE_ARBITRATION myArbitration;
+    HEADING_MODE myHeadingMode;
+    int myOwner;
+    unsigned int myHandoffs;
+    double myTriggerGain;
+    double myTriggerSlew;
+
+    // Slew-limited trigger rotation per pad, in whole deg/s, and when it
+    // was last advanced
+    double myTriggerRot[MAX_CONTROLLERS];
+    long long myTriggerUs[MAX_CONTROLLERS];
+
+    // Each pad's contribution, recomputed only when that pad changes
+    MOTION_TARGET myPadIntent[MAX_CONTROLLERS];
+    unsigned int myLastPacket[MAX_CONTROLLERS];
+    bool myLastConnected[MAX_CONTROLLERS];
+    unsigned int myLastShapingGeneration;
+    bool myLastEasyRotate;
+    bool myHaveLast;
+    std::atomic<bool> myEasyRotate;
+
+    ButtonBindings myButtons;
+    unsigned int myHandoffPending;      // pads whose handoff fired this snapshot
+    ArFunctor1C<RobotDriveThread, int> myHandoffCB;
+
+    unsigned int mySkippedSnapshots;
+    unsigned int mySnapshots;
+};
@@ -8,8 +8,7 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 //-----------------------------------------------------------------------------
 
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
+#include "SimpleController.h"
 #include <commctrl.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,53 +16,36 @@
 #include <basetsd.h>
 #include <objbase.h>
 #include <shellapi.h>
-#include <math.h>
+#include <dbt.h>
 #include "Aria.h"
-
-#ifdef USE_DIRECTX_SDK
-#include <C:\Program Files (x86)\Microsoft DirectX SDK (June 2010)\include\xinput.h>
-#pragma comment(lib,"xinput.lib")
-#elif (_WIN32_WINNT >= 0x0602 /*_WIN32_WINNT_WIN8*/)
-#include <XInput.h>
-#pragma comment(lib,"xinput.lib")
-#else
-#include <XInput.h>
-#pragma comment(lib,"xinput9_1_0.lib")
-#endif
+#include "ControllerBridge.h"
+#include "HeadlessMain.h"
+#include "HighResClock.h"
+#include "ControllerStatus.h"
 
 
 //-----------------------------------------------------------------------------
 // Function-prototypes
 //-----------------------------------------------------------------------------
 LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam );
-HRESULT UpdateControllerState();
-void RenderFrame();
+void RenderFrame( const CONTROLLER_SNAPSHOT &snapshot );
 
 
 //-----------------------------------------------------------------------------
 // Defines, constants, and global variables
 //-----------------------------------------------------------------------------
-#define MAX_CONTROLLERS 4                          // XInput handles up to 4 controllers 
-#define INPUT_DEADZONE  ( 0.24f * FLOAT(0x7FFF) )  // Default to 24% of the +/- 32767 range.   This is a reasonable default value but can be altered if needed.
 #define BUTTON_ONE 3301
 #define BUTTON_TWO 3302
 #define BUTTON_THREE 3303
 #define COMBOBOX1 3304
 #define backgroundColor 0x14FDFD                   //REMIND: Windows' rgb is represent in reverse order!
 #define textColor 0x000000
+#define STATUS_LEFT 20                // where the controller lines start
+#define STATUS_TOP 120
+#define STATUS_PAD_HEIGHT 120         // space for each controller's lines
 
-#define CONS1 (1.05/2)
-#define CONS2 (1.732/2)
-#define ROTATE_DELAY 18
-
-struct CONTROLLER_STATE
-{
-    XINPUT_STATE state;
-    bool bConnected;  //記錄搖桿有沒有連線
-};
-
-CONTROLLER_STATE g_Controllers[MAX_CONTROLLERS];
-WCHAR   g_szMessage[4][1024] = {0};  //記錄四個搖桿的狀態(XInputGetState拿到的值)
+CONTROLLER_STATUS g_Status[MAX_CONTROLLERS];  //記錄四個搖桿的狀態(XInputGetState拿到的值)
+int     g_iLineHeight = 0;           //目前字型一行的高度, 0 until the first paint
 HWND    g_hWnd;                      //主控台視窗控制代碼
 bool    g_bDeadZoneOn = true;        //記錄deadzone開或關
 HINSTANCE  hg_app;                   //記錄button的HINSTANCE
@@ -71,27 +53,90 @@ int		button_flag[3];				 //用來紀錄button有無被clicked
 int     currentFont;                 //記錄font
 int     rotate_flag;                 //easy rotate的開關
 
-// Central object that is an interface to the robot and its integrated
-// devices, and which manages control of the robot by the rest of the program.
-ArRobot robot;
+// What g_Status currently shows, so unchanged pads are not compared again
+unsigned int g_uRenderedPacket[MAX_CONTROLLERS];
+bool    g_bRenderedConnected[MAX_CONTROLLERS];
+unsigned int g_uRenderedGeneration;
+bool    g_bRenderedOnce = false;
+unsigned int g_uPadsFormatted = 0;   //實際重新產生字串的次數
+unsigned int g_uPadsSkipped = 0;     //沒有變化而略過的次數
+unsigned int g_uFieldsFormatted = 0; //重新產生的欄位數
+LatencyHistogram g_DisplayLatency;   //搖桿取樣到畫面處理的延遲
+
+// Samples the controllers at a fixed rate, independent of the message pump,
+// and drives the robots from them
+GamepadXInput g_Gamepad;
+ControllerBridge g_Bridge( &g_Gamepad );
+
+// Runs on the input thread
+bool postControllerUpdate()
+{
+  return PostMessage(g_hWnd, WM_CONTROLLER_UPDATE, 0, 0) != FALSE;
+}
 
-bool handleDebugMessage(ArRobotPacket *pkt)
+// Runs on the UI thread; 'L' and exit
+void logLatency()
 {
-  if(pkt->getID() != ArCommands::MARCDEBUG) return false;
-  char msg[256];
-  pkt->bufToStr(msg, sizeof(msg));
-  msg[255] = 0;
-  ArLog::log(ArLog::Terse, "Controller Firmware Debug: %s", msg);
-  return true;
+  g_DisplayLatency.log("Latency display input->render");
+  g_Bridge.logLatency();
+}
+
+// Pad shortcuts for the window's keys.  They run on the drive threads, so
+// they post the key instead of touching the UI.
+#define PAD_ACTION_DEADZONE    ( DRIVE_ACTION_FIRST_FREE )
+#define PAD_ACTION_LOG_LATENCY ( DRIVE_ACTION_FIRST_FREE + 1 )
+
+static const BUTTON_RULE g_PadShortcuts[] =
+{
+    { GAMEPAD_Y, BUTTON_DOUBLE_TAP, 300, PAD_ACTION_DEADZONE },
+    { GAMEPAD_LEFT_SHOULDER | GAMEPAD_RIGHT_SHOULDER, BUTTON_HOLD, 1000, PAD_ACTION_LOG_LATENCY },
+};
+
+void padToggleDeadZone(int)
+{
+  PostMessage(g_hWnd, WM_KEYDOWN, 'D', 0);
+}
+
+void padLogLatency(int)
+{
+  PostMessage(g_hWnd, WM_KEYDOWN, 'L', 0);
 }
 
 //-----------------------------------------------------------------------------
 // Name: WinMain()
-// Desc: Entry point for the application.  Since we use a simple dialog for 
-//       user interaction we don't need to pump messages.
+// Desc: Entry point for the application.  Controller sampling and robot
+//       commands run on their own threads, so the message loop only has to
+//       pump messages and repaint.  With -headless none of the window is
+//       created.
 //-----------------------------------------------------------------------------
 int WINAPI wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE, _In_ LPWSTR, _In_ int )
 {
+    //get command line argument + 轉型成char**
+    int argc;
+    LPWSTR *tmpargv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (NULL == tmpargv) {
+        wprintf(L"CommandLineToArgvW failed\n");
+    }
+    char **argv = (char**)malloc(sizeof(char*) * argc);
+    for (int i = 0; i < argc; i++) {
+        argv[i] = (char*)malloc(sizeof(char) * 500);
+        wcstombs(argv[i], tmpargv[i], 500);
+    }
+    
+    //Free memory allocated for CommandLineToArgvW arguments.
+    //LocalFree(argv);
+
+    // Console or service use: no window, no message loop
+    if( TakeArgument( &argc, argv, "-headless" ) )
+    {
+        if( AttachConsole( ATTACH_PARENT_PROCESS ) )
+        {
+            freopen( "CONOUT$", "w", stdout );
+            freopen( "CONOUT$", "w", stderr );
+        }
+        return RunHeadless( argc, argv );
+    }
+
     // Initialize COM
     HRESULT hr;
     if( FAILED( hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED) ) )
@@ -126,146 +171,13 @@ int WINAPI wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE, _In_ LPWSTR,
     // If you want ArLog to print "Verbose" level messages uncomment this:
     //ArLog::init(ArLog::StdOut, ArLog::Verbose);
 
-    //get command line argument + 轉型成char**
-    int argc;
-    LPWSTR *tmpargv = CommandLineToArgvW(GetCommandLineW(), &argc);
-    if (NULL == tmpargv) {
-        wprintf(L"CommandLineToArgvW failed\n");
-    }
-    char **argv = (char**)malloc(sizeof(char*) * argc);
-    for (int i = 0; i < argc; i++) {
-        argv[i] = (char*)malloc(sizeof(char) * 500);
-        wcstombs(argv[i], tmpargv[i], 500);
+    // Connect the robot and its devices, with the options from the command line
+    if( !g_Bridge.connect( &argc, argv, BRIDGE_WINDOW ) )
+    {
+        Aria::exit( 1 );
+        return 1;
     }
     
-    //Free memory allocated for CommandLineToArgvW arguments.
-    //LocalFree(argv);
-    
-    // This object parses program options from the command line
-     ArArgumentParser parser(&argc, argv);
-    
-    // Load some default values for command line arguments from /etc/Aria.args
-    // (Linux) or the ARIAARGS environment variable.
-     parser.loadDefaultArguments();
-    
-    // Object that connects to the robot or simulator using program options
-     ArRobotConnector robotConnector(&parser, &robot);
-    
-    // If the robot has an Analog Gyro, this object will activate it, and 
-    // if the robot does not automatically use the gyro to correct heading,
-    // this object reads data from it and corrects the pose in ArRobot
-     ArAnalogGyro gyro(&robot);
-    
-    robot.addPacketHandler(new ArGlobalRetFunctor1<bool, ArRobotPacket*>(&handleDebugMessage));
-    
-    // Connect to the robot, get some initial data from it such as type and name,
-    // and then load parameter files for this robot.
-     if (!robotConnector.connectRobot())
-     {
-       // Error connecting:
-       // if the user gave the -help argumentp, then just print out what happened,
-       // and continue so options can be displayed later.
-       if (!parser.checkHelpAndWarnUnparsed())
-       {
-         ArLog::log(ArLog::Terse, "Could not connect to robot, will not have parameter file so options displayed later may not include everything");
-       }
-       // otherwise abort
-       else
-       {
-         ArLog::log(ArLog::Terse, "Error, could not connect to robot.");
-         Aria::logOptions();
-         Aria::exit(1);
-       }
-     }
-    
-    if(!robot.isConnected())
-     {
-       ArLog::log(ArLog::Terse, "Internal error: robot connector succeeded but ArRobot::isConnected() is false!");
-     }
-    
-    // Connector for laser rangefinders
-     ArLaserConnector laserConnector(&parser, &robot, &robotConnector);
-    
-    // Connector for compasses
-     ArCompassConnector compassConnector(&parser);
-    
-    // Parse the command line options. Fail and print the help message if the parsing fails
-    // or if the help was requested with the -help option
-     if (!Aria::parseArgs() || !parser.checkHelpAndWarnUnparsed())
-     {    
-       Aria::logOptions();
-       Aria::exit(1);
-       return 1;
-     }
-    
-    // Used to access and process sonar range data
-     ArSonarDevice sonarDev;
-     
-    // Used to perform actions when keyboard keys are pressed
-     ArKeyHandler keyHandler;
-     Aria::setKeyHandler(&keyHandler);
-    
-    // ArRobot contains an exit action for the Escape key. It also 
-    // stores a pointer to the keyhandler so that other parts of the program can
-    // use the same keyhandler.
-     robot.attachKeyHandler(&keyHandler);
-     printf("You may press escape to exit\n");
-    
-    // Attach sonarDev to the robot so it gets data from it.
-     robot.addRangeDevice(&sonarDev);
-    
-    
-    // Start the robot task loop running in a new background thread. The 'true' argument means if it loses
-    // connection the task loop stops and the thread exits.
-     robot.runAsync(true);
-    
-    // Connect to the laser(s) if lasers were configured in this robot's parameter
-    // file or on the command line, and run laser processing thread if applicable
-    // for that laser class.  For the purposes of this demo, add all
-    // possible lasers to ArRobot's list rather than just the ones that were
-    // connected by this call so when you enter laser mode, you
-    // can then interactively choose which laser to use from that list of all
-    // lasers mentioned in robot parameters and on command line. Normally,
-    // only connected lasers are put in ArRobot's list.
-     if (!laserConnector.connectLasers(
-           false,  // continue after connection failures
-           false,  // add only connected lasers to ArRobot
-           true    // add all lasers to ArRobot
-     ))
-     {
-        printf("Warning: Could not connect to laser(s). Set LaserAutoConnect to false in this robot's individual parameter file to disable laser connection.\n");
-     }
-    
-    /* not needed, robot connector will do it by default
-     if (!sonarConnector.connectSonars(
-           false,  // continue after connection failures
-           false,  // add only connected lasers to ArRobot
-           true    // add all lasers to ArRobot
-     ))
-     {
-       printf("Could not connect to sonars... exiting\n");
-       Aria::exit(2);
-     }
-    */
-    
-    // Create and connect to the compass if the robot has one.
-     ArTCM2 *compass = compassConnector.create(&robot);
-     if(compass && !compass->blockingConnect()) {
-       compass = NULL;
-     }
-     
-    // Sleep for 1 second so some messages from the initial responses
-    // from robots and cameras and such can catch up
-    ArUtil::sleep(1000);
-
-    // Set forward velocity to 50 mm/s
-    robot.lock();
-    robot.enableMotors();
-    robot.setVel(1);
-    robot.unlock();
-    ArUtil::sleep(1000);
-    robot.setVel(0);
-    
 
     //set default font
     currentFont = 2;
@@ -273,32 +185,36 @@ int WINAPI wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE, _In_ LPWSTR,
     //default rotate flag
     rotate_flag = 1;
 
-    // Init state
-    ZeroMemory( g_Controllers, sizeof( CONTROLLER_STATE ) * MAX_CONTROLLERS );
-
-    // Enter the message loop
-    bool bGotMsg;
+    // Start sampling the controllers and driving the robots from them
+    ArGlobalFunctor1<int> padDeadZoneCB( &padToggleDeadZone );
+    ArGlobalFunctor1<int> padLogLatencyCB( &padLogLatency );
+    ArGlobalRetFunctor<bool> controllerUpdateCB( &postControllerUpdate );
+    g_Bridge.setPadShortcuts( g_PadShortcuts, sizeof( g_PadShortcuts ) / sizeof( g_PadShortcuts[0] ) );
+    g_Bridge.setPadAction( PAD_ACTION_DEADZONE, &padDeadZoneCB );
+    g_Bridge.setPadAction( PAD_ACTION_LOG_LATENCY, &padLogLatencyCB );
+    g_Bridge.getInputThread()->setDeadZone( g_bDeadZoneOn );
+    g_Bridge.getInputThread()->setDisplayNotifyCB( &controllerUpdateCB );
+    g_Bridge.start();
+    g_Bridge.setEasyRotate( rotate_flag != 0 );
+
+    // Enter the message loop.  New controller state arrives as
+    // WM_CONTROLLER_UPDATE, so there is nothing to do while the queue is empty.
     MSG msg;
-    msg.message = WM_NULL;
-
-    while( WM_QUIT != msg.message )
+    while( GetMessage( &msg, nullptr, 0U, 0U ) > 0 )
     {
-        // Use PeekMessage() so we can use idle time to render the scene and call pEngine->DoWork()
-        bGotMsg = ( PeekMessage( &msg, nullptr, 0U, 0U, PM_REMOVE ) != 0 );
-
-        if( bGotMsg )
-        {
-            // Translate and dispatch the message
-            TranslateMessage( &msg );
-            DispatchMessage( &msg );
-        }
-        else
-        {
-            UpdateControllerState();
-            RenderFrame();
-        }
+        // Translate and dispatch the message
+        TranslateMessage( &msg );
+        DispatchMessage( &msg );
     }
 
+    g_Bridge.getInputThread()->setDisplayNotifyCB( nullptr );
+
+    ArLog::log( ArLog::Normal, "Input: %u empty slot probes; display: %u of %u pad updates skipped, %u lines redrawn",
+                g_Gamepad.getConnectionManager()->getProbes(),
+                g_uPadsSkipped, g_uPadsSkipped + g_uPadsFormatted, g_uFieldsFormatted );
+    g_DisplayLatency.log( "Latency display input->render" );
+    g_Bridge.stop();
+
     //clean up ARIA
     Aria::exit(0);
 
@@ -312,428 +228,64 @@ int WINAPI wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE, _In_ LPWSTR,
 
 
 //-----------------------------------------------------------------------------
-HRESULT UpdateControllerState()
-{
-    DWORD dwResult;
-    for( DWORD i = 0; i < MAX_CONTROLLERS; i++ )
-    {
-        // Simply get the state of the controller from XInput.
-        dwResult = XInputGetState( i, &g_Controllers[i].state );
-
-        if( dwResult == ERROR_SUCCESS )
-            g_Controllers[i].bConnected = true;
-        else
-            g_Controllers[i].bConnected = false;
-    }
-
-    return S_OK;
-}
-
-
+// Name: RenderFrame()
+// Desc: Refresh the status text from the newest snapshot.  Called on the UI
+//       thread for WM_CONTROLLER_UPDATE.  Pads whose packet number has not
+//       moved since they were last shown are not looked at again; for the
+//       rest only the fields that changed are formatted, and only their
+//       lines are invalidated.
 //-----------------------------------------------------------------------------
-void RenderFrame()
+void RenderFrame( const CONTROLLER_SNAPSHOT &snapshot )
 {
-    bool bRepaint = false;
+    bool bRedrawn = false;
 
-    WCHAR sz[4][1024];
-    WORD wButtons;
-    for( DWORD i = 0; i < MAX_CONTROLLERS; i++ )
-    {
-        if( g_Controllers[i].bConnected )
-        {
-            wButtons = g_Controllers[i].state.Gamepad.wButtons;
+    // The dead zone toggle changes what is shown without a new packet
+    bool bAll = !g_bRenderedOnce || snapshot.uShapingGeneration != g_uRenderedGeneration;
+    g_bRenderedOnce = true;
+    g_uRenderedGeneration = snapshot.uShapingGeneration;
 
-            if( g_bDeadZoneOn )
-            {
-                // Zero value if thumbsticks are within the dead zone 
-                if( ( g_Controllers[i].state.Gamepad.sThumbLX < INPUT_DEADZONE &&
-                      g_Controllers[i].state.Gamepad.sThumbLX > -INPUT_DEADZONE ) &&
-                    ( g_Controllers[i].state.Gamepad.sThumbLY < INPUT_DEADZONE &&
-                      g_Controllers[i].state.Gamepad.sThumbLY > -INPUT_DEADZONE ) )
-                {
-                    g_Controllers[i].state.Gamepad.sThumbLX = 0;
-                    g_Controllers[i].state.Gamepad.sThumbLY = 0;
-                }
-
-                if( ( g_Controllers[i].state.Gamepad.sThumbRX < INPUT_DEADZONE &&
-                      g_Controllers[i].state.Gamepad.sThumbRX > -INPUT_DEADZONE ) &&
-                    ( g_Controllers[i].state.Gamepad.sThumbRY < INPUT_DEADZONE &&
-                      g_Controllers[i].state.Gamepad.sThumbRY > -INPUT_DEADZONE ) )
-                {
-                    g_Controllers[i].state.Gamepad.sThumbRX = 0;
-                    g_Controllers[i].state.Gamepad.sThumbRY = 0;
-                }
-            }
-
-            swprintf_s( sz[i], 1024,
-                              L"Controller %u: Connected\n"
-                              L"  Pressed Buttons: %s%s%s%s%s%s%s%s%s%s%s%s%s%s\n"
-                              L"  Left Trigger: %u\n"
-                              L"  Right Trigger: %u\n"
-                              L"  Left Thumbstick: %d/%d\n"
-                              L"  Right Thumbstick: %d/%d", i,
-                              ( wButtons & XINPUT_GAMEPAD_DPAD_UP ) ? L"DPAD_UP " : L"",
-                              ( wButtons & XINPUT_GAMEPAD_DPAD_DOWN ) ? L"DPAD_DOWN " : L"",
-                              ( wButtons & XINPUT_GAMEPAD_DPAD_LEFT ) ? L"DPAD_LEFT " : L"",
-                              ( wButtons & XINPUT_GAMEPAD_DPAD_RIGHT ) ? L"DPAD_RIGHT " : L"",
-                              ( wButtons & XINPUT_GAMEPAD_START ) ? L"START " : L"",
-                              ( wButtons & XINPUT_GAMEPAD_BACK ) ? L"BACK " : L"",
-                              ( wButtons & XINPUT_GAMEPAD_LEFT_THUMB ) ? L"LEFT_THUMB " : L"",
-                              ( wButtons & XINPUT_GAMEPAD_RIGHT_THUMB ) ? L"RIGHT_THUMB " : L"",
-                              ( wButtons & XINPUT_GAMEPAD_LEFT_SHOULDER ) ? L"LEFT_SHOULDER " : L"",
-                              ( wButtons & XINPUT_GAMEPAD_RIGHT_SHOULDER ) ? L"RIGHT_SHOULDER " : L"",
-                              ( wButtons & XINPUT_GAMEPAD_A ) ? L"A " : L"",
-                              ( wButtons & XINPUT_GAMEPAD_B ) ? L"B " : L"",
-                              ( wButtons & XINPUT_GAMEPAD_X ) ? L"X " : L"",
-                              ( wButtons & XINPUT_GAMEPAD_Y ) ? L"Y " : L"",
-                              g_Controllers[i].state.Gamepad.bLeftTrigger,
-                              g_Controllers[i].state.Gamepad.bRightTrigger,
-                              g_Controllers[i].state.Gamepad.sThumbLX,
-                              g_Controllers[i].state.Gamepad.sThumbLY,
-                              g_Controllers[i].state.Gamepad.sThumbRX,
-                              g_Controllers[i].state.Gamepad.sThumbRY );
-        }
-        else
+    RECT client;
+    GetClientRect( g_hWnd, &client );
+    for( int i = 0; i < MAX_CONTROLLERS; i++ )
+    {
+        const GAMEPAD_STATE &pad = snapshot.pads[i];
+        if( !bAll && pad.bConnected == g_bRenderedConnected[i] &&
+            pad.uPacket == g_uRenderedPacket[i] )
         {
-            swprintf_s( sz[i], 1024, L"Controller %u: Not connected", i );
-        }
-
-        //start鍵當作reset鍵
-        if (wButtons & XINPUT_GAMEPAD_START) {
-            robot.lock();
-            robot.setVel(0);
-            robot.setRotVel(0);
-            robot.unlock();
-        }
-
-        //change the ArRobot object's rotating velocity
-        if (g_Controllers[i].state.Gamepad.bLeftTrigger) {
-            robot.lock();
-            robot.setRotVel(550);
-            robot.unlock();
-            ArUtil::sleep(18);
-            robot.lock();
-            robot.setRotVel(0);
-            robot.unlock();
-        }
-        else if (g_Controllers[i].state.Gamepad.bRightTrigger) {
-            robot.lock();
-            robot.setRotVel(-550);
-            robot.unlock();
-            ArUtil::sleep(18);
-            robot.lock();
-            robot.setRotVel(0);
-            robot.unlock();
+            g_uPadsSkipped++;
+            continue;
         }
+        g_bRenderedConnected[i] = pad.bConnected;
+        g_uRenderedPacket[i] = pad.uPacket;
+        g_uPadsFormatted++;
 
-        //change the ArRobot object's velocity by 方向鍵
-        if (wButtons & XINPUT_GAMEPAD_DPAD_UP) {
-            robot.lock();
-            robot.setVel(250);
-            robot.unlock();
-            ArUtil::sleep(12);
-            robot.setVel(0);
-        }
-        else if (wButtons & XINPUT_GAMEPAD_DPAD_DOWN) {
-            robot.lock();
-            robot.setVel(-250);
-            robot.unlock();
-            ArUtil::sleep(12);
-            robot.setVel(0);
-        }
-        else if (wButtons & XINPUT_GAMEPAD_DPAD_LEFT) {
-            robot.lock();
-            robot.setRotVel(210);
-            robot.unlock();
-            ArUtil::sleep(12);
-            robot.setRotVel(0);
-        }
-        else if (wButtons & XINPUT_GAMEPAD_DPAD_RIGHT) {
-            robot.lock();
-            robot.setRotVel(-210);
-            robot.unlock();
-            ArUtil::sleep(12);
-            robot.setRotVel(0);
-        }
-
-        //change the ArRobot object's velocity by 左搖桿
-        double LX = double(g_Controllers[i].state.Gamepad.sThumbLX);
-        double LY = double(g_Controllers[i].state.Gamepad.sThumbLY);
-        double cosine = LX / (sqrt(pow(LX, 2) + pow(LY, 2)));
-        if (LY > 0 && LX > 0) {
-            //第一象限
-            if (cosine > CONS2) {
-                //0~30度
-                robot.lock();
-                robot.setVel2(250, 30);
-                robot.unlock();
-                ArUtil::sleep(ROTATE_DELAY);
-                robot.lock();
-                robot.setVel2(0, 0);
-                robot.unlock();
-                //robot.stop();
-            }
-            else if (cosine < CONS1){
-                //60~90度
-                // robot.lock();
-                // robot.setVel2(0, 0);
-                // robot.unlock();
-                robot.lock();
-                //robot.setVel2(0, 0);
-                robot.setVel(250);
-                //robot.move(100);
-                robot.unlock();
-                ArUtil::sleep(30);
-                robot.lock();
-                robot.setVel(0);
-                robot.setVel2(0, 0);
-                robot.unlock();
-            }
-            else {
-                //30~60度
-                robot.lock();
-                robot.setVel2(230, 100);
-                robot.unlock();
-                ArUtil::sleep(ROTATE_DELAY);
-                robot.lock();
-                robot.setVel2(0, 0);
-                robot.unlock();
-                //robot.stop();
-            }
-        }
-        else if (LY > 0 && LX < 0) {
-            //第二象限
-            if (cosine < -CONS2) {
-                //150~180度
-                robot.lock();
-                robot.setVel2(30, 250);
-                robot.unlock();
-                ArUtil::sleep(ROTATE_DELAY);
-                robot.lock();
-                robot.setVel2(0, 0);
-                robot.unlock();
-                //robot.stop();
-            }
-            else if (cosine > -CONS1){
-                //90~120度
-                // robot.lock();
-                // robot.setVel2(0, 0);
-                // robot.unlock();
-                robot.lock();
-                //robot.setVel2(0, 0);
-                robot.setVel(250);
-                //robot.move(100);
-                robot.unlock();
-                ArUtil::sleep(30);
-                robot.lock();
-                robot.setVel(0);
-                robot.setVel2(0, 0);
-                robot.unlock();
-            }
-            else {
-                //120~150度
-                robot.lock();
-                robot.setVel2(100, 230);
-                robot.unlock();
-                ArUtil::sleep(ROTATE_DELAY);
-                robot.lock();
-                robot.setVel2(0, 0);
-                robot.unlock();
-                //robot.stop();
-            }
-        }
-        if (LY < 0 && LX < 0) {
-            //第三象限
-            if (cosine < -CONS2) {
-                //180~210度
-                robot.lock();
-                robot.setVel2(-30, -250);
-                robot.unlock();
-                ArUtil::sleep(ROTATE_DELAY);
-                robot.lock();
-                robot.setVel2(0, 0);
-                robot.unlock();
-                //robot.stop();
-            }
-            else if (cosine > -CONS1){
-                //240~270度
-                // robot.lock();
-                // robot.setVel2(0, 0);
-                // robot.unlock();
-                robot.lock();
-                //robot.setVel2(0, 0);
-                robot.setVel(-250);
-                //robot.move(100);
-                robot.unlock();
-                ArUtil::sleep(30);
-                robot.lock();
-                robot.setVel(0);
-                robot.setVel2(0, 0);
-                robot.unlock();
-            }
-            else {
-                //210~240度
-                robot.lock();
-                robot.setVel2(-100, -230);
-                robot.unlock();
-                ArUtil::sleep(ROTATE_DELAY);
-                robot.lock();
-                robot.setVel2(0, 0);
-                robot.unlock();
-                //robot.stop();
-            }
-        }
-        else if (LY < 0 && LX > 0) {
-            //第四象限
-            if (cosine > CONS2) {
-                //330~360度
-                robot.lock();
-                robot.setVel2(-250, -30);
-                robot.unlock();
-                ArUtil::sleep(ROTATE_DELAY);
-                robot.lock();
-                robot.setVel2(0, 0);
-                robot.unlock();
-                //robot.stop();
-            }
-            else if (cosine < CONS1){
-                //270~300度
-                // robot.lock();
-                // robot.setVel2(0, 0);
-                // robot.unlock();
-                robot.lock();
-                //robot.setVel2(0, 0);
-                robot.setVel(-250);
-                //robot.move(100);
-                robot.unlock();
-                ArUtil::sleep(30);
-                robot.lock();
-                robot.setVel(0);
-                robot.setVel2(0, 0);
-                robot.unlock();
-            }
-            else {
-                //300~330度
-                robot.lock();
-                robot.setVel2(-230, -100);
-                robot.unlock();
-                ArUtil::sleep(ROTATE_DELAY);
-                robot.lock();
-                robot.setVel2(0, 0);
-                robot.unlock();
-                //robot.stop();
-            }
-        }
-        //robot.stop();
-
-        //change the ArRobot object's velocity by 右搖桿
-        if (rotate_flag) {
-            LX = double(g_Controllers[i].state.Gamepad.sThumbRX);
-            LY = double(g_Controllers[i].state.Gamepad.sThumbRY);
-            cosine = LX / (sqrt(pow(LX, 2) + pow(LY, 2)));
-            if (LY > 0 && LX > 0) {
-                //第一象限
-                if (cosine > CONS2) {
-                    //0~30度
-                    robot.lock();
-                    robot.setDeltaHeading(-90);
-                    robot.unlock();
-                }
-                else if (cosine < CONS1){
-                    //60~90度
-                    robot.lock();
-                    robot.setDeltaHeading(0);
-                    robot.unlock();
-                }
-                else {
-                    //30~60度
-                    robot.lock();
-                    robot.setDeltaHeading(-45);
-                    robot.unlock();
-                }
-            }
-            else if (LY > 0 && LX < 0) {
-                //第二象限
-                if (cosine < -CONS2) {
-                    //150~180度
-                    robot.lock();
-                    robot.setDeltaHeading(90);
-                    robot.unlock();
-                }
-                else if (cosine > -CONS1){
-                    //90~120度
-                    robot.lock();
-                    robot.setDeltaHeading(0);
-                    robot.unlock();
-                }
-                else {
-                    //120~150度
-                    robot.lock();
-                    robot.setDeltaHeading(45);
-                    robot.unlock();
-                }
-            }
-            if (LY < 0 && LX < 0) {
-                //第三象限
-                if (cosine < -CONS2) {
-                    //180~210度
-                    robot.lock();
-                    robot.setDeltaHeading(90);
-                    robot.unlock();
-                }
-                else if (cosine > -CONS1){
-                    //240~270度
-                    robot.lock();
-                    robot.setDeltaHeading(180);
-                    robot.unlock();
-                }
-                else {
-                    //210~240度
-                    robot.lock();
-                    robot.setDeltaHeading(135);
-                    robot.unlock();
-                }
-            }
-            else if (LY < 0 && LX > 0) {
-                //第四象限
-                if (cosine > CONS2) {
-                    //330~360度
-                    robot.lock();
-                    robot.setDeltaHeading(-90);
-                    robot.unlock();
-                }
-                else if (cosine < CONS1){
-                    //270~300度
-                    robot.lock();
-                    robot.setDeltaHeading(-180);
-                    robot.unlock();
-                }
-                else {
-                    //300~330度
-                    robot.lock();
-                    robot.setDeltaHeading(-135);
-                    robot.unlock();
-                }
-            }
-        }
-
-        if( wcscmp( sz[i], g_szMessage[i] ) != 0 )
+        unsigned int changed = UpdateControllerStatus( &g_Status[i], i, pad );
+        for( int field = 0; field < STATUS_FIELDS; field++ )
         {
-            wcscpy_s( g_szMessage[i], 1024, sz[i] );
-            bRepaint = true;
+            if( !( changed & ( 1u << field ) ) )
+                continue;
+            g_uFieldsFormatted++;
+            bRedrawn = true;
+
+            // Before the first paint the line height is not known yet
+            if( g_iLineHeight == 0 )
+                continue;
+            RECT rect;
+            rect.left = STATUS_LEFT;
+            rect.right = client.right;
+            rect.top = STATUS_TOP + i * STATUS_PAD_HEIGHT + field * g_iLineHeight;
+            rect.bottom = rect.top + g_iLineHeight;
+            InvalidateRect( g_hWnd, &rect, TRUE );
         }
     }
 
-    if( bRepaint )
+    if( bRedrawn )
     {
-        // Repaint the window if needed 
-        InvalidateRect( g_hWnd, nullptr, TRUE );
+        // Repaint just the invalidated lines now
+        if( g_iLineHeight == 0 )
+            InvalidateRect( g_hWnd, nullptr, TRUE );
         UpdateWindow( g_hWnd );
     }
-
-    // This sample doesn't use Direct3D.  Instead, it just yields CPU time to other 
-    // apps but this is not typically done when rendering
-    Sleep( 10 );
 }
 
 
@@ -772,9 +324,25 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
             break;
         }
 
+        case WM_DEVICECHANGE:
+        {
+            // A pad may have been plugged in; don't wait for the backoff
+            if( wParam == DBT_DEVNODES_CHANGED || wParam == DBT_DEVICEARRIVAL )
+                g_Gamepad.deviceChanged();
+            break;
+        }
+
         case WM_KEYDOWN:
         {
-            if( wParam == 'D' ) g_bDeadZoneOn = !g_bDeadZoneOn;
+            if( wParam == 'D' )
+            {
+                g_bDeadZoneOn = !g_bDeadZoneOn;
+                g_Bridge.getInputThread()->setDeadZone( g_bDeadZoneOn );
+            }
+            else if( wParam == 'L' )
+            {
+                logLatency();
+            }
             break;
         }
 
@@ -854,6 +422,8 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
                 {
                     currentFont = 7;
                 }
+                // Every line moves with the new font
+                InvalidateRect(hWnd, nullptr, TRUE);
                 //MessageBox(hWnd, (LPCWSTR)ListItem, TEXT("Item Selected"), MB_OK);                        
             }
 
@@ -865,11 +435,13 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
                         SendMessage((HWND)lParam, WM_SETTEXT, (WPARAM)NULL, (LPARAM)L"Deadzone Off");
                         button_flag[0] = 1;
                         g_bDeadZoneOn = FALSE;
+                        g_Bridge.getInputThread()->setDeadZone( false );
                     }
 				    else if (button_flag[0] == 1) {
                         SendMessage((HWND)lParam, WM_SETTEXT, (WPARAM)NULL, (LPARAM)L"Deadzone On");
                         button_flag[0] = 0;
                         g_bDeadZoneOn = TRUE;
+                        g_Bridge.getInputThread()->setDeadZone( true );
                     }
                     break;
 
@@ -879,11 +451,13 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
                         SendMessage((HWND)lParam, WM_SETTEXT, (WPARAM)NULL, (LPARAM)L"Easy Rotate Off");
                         button_flag[1] = 1;
                         rotate_flag = 0;
+                        g_Bridge.setEasyRotate( false );
                     }
                     else if (button_flag[1] == 1) {
                         SendMessage((HWND)lParam, WM_SETTEXT, (WPARAM)NULL, (LPARAM)L"Easy Rotate On");
                         button_flag[1] = 0;
                         rotate_flag = 1;
+                        g_Bridge.setEasyRotate( true );
                     }  
                     break;
 
@@ -902,6 +476,28 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
                 default:
                     break;
             }  
+            return 0;
+        }
+
+        case WM_CONTROLLER_UPDATE:
+        {
+            // Re-arm the notification before reading so a sample published
+            // while we paint is not missed
+            g_Bridge.getInputThread()->displayConsumed();
+            const CONTROLLER_SNAPSHOT *snapshot = g_Bridge.getInputThread()->getDisplaySlot()->consume();
+            if( snapshot != nullptr )
+            {
+                long long llInputUs = 0;
+                for( int i = 0; i < MAX_CONTROLLERS; i++ )
+                {
+                    if( snapshot->pads[i].llTimeUs > llInputUs )
+                        llInputUs = snapshot->pads[i].llTimeUs;
+                }
+                RenderFrame( *snapshot );
+                if( llInputUs != 0 )
+                    g_DisplayLatency.add( MonotonicMicros() - llInputUs );
+            }
+            return 0;
         }
 
         case WM_PAINT:
@@ -919,22 +515,43 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
                 TEXT("Arial"), TEXT("Times New Roman"), TEXT("Monaco"), TEXT("Impact"), TEXT("Helvetica"), TEXT("Georgia"), TEXT("Gotham")
             };
  
-            font = CreateFont(0, 0, 0, 0,
-                            FW_DONTCARE, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_OUTLINE_PRECIS,
-                            CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY, VARIABLE_PITCH, FontDictionary[currentFont-1]);
+            // Create the font once per selection, not on every paint
+            static HFONT hStatusFont = nullptr;
+            static int statusFont = 0;
+            if( hStatusFont == nullptr || statusFont != currentFont )
+            {
+                if( hStatusFont != nullptr )
+                    DeleteObject( hStatusFont );
+                hStatusFont = CreateFont(0, 0, 0, 0,
+                                FW_DONTCARE, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_OUTLINE_PRECIS,
+                                CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY, VARIABLE_PITCH, FontDictionary[currentFont-1]);
+                statusFont = currentFont;
+            }
+            font = hStatusFont;
 
             SelectObject(hDC, font);
+            TEXTMETRIC tm;
+            GetTextMetrics( hDC, &tm );
+            g_iLineHeight = tm.tmHeight + tm.tmExternalLeading;
 
+            RECT clip;
             rect.top = 15;
             rect.left = 20;
-            DrawText( hDC,
-                      L"You can connect upto 4 controllers.\nIf you turn on 'Easy Rotate'\nLeft trigger will represent rotating counter-clockwise\nRight trigger will represent rotating clockwise\nPress 'D' to toggle dead zone clamping.", -1, &rect, 0 );
+            if( IntersectRect( &clip, &rect, &ps.rcPaint ) )
+                DrawText( hDC,
+                          L"You can connect upto 4 controllers.\nIf you turn on 'Easy Rotate'\nLeft trigger will represent rotating counter-clockwise\nRight trigger will represent rotating clockwise\nPress 'D' (or double-tap Y) to toggle dead zone clamping.\nPress 'L' (or hold both bumpers) to log input latency.", -1, &rect, 0 );
 
-            for( DWORD i = 0; i < MAX_CONTROLLERS; i++ )
+            // Only the lines inside the update region are drawn
+            for( int i = 0; i < MAX_CONTROLLERS; i++ )
             {
-                rect.top = i * 120 + 120;
-                rect.left = 20;
-                DrawText( hDC, g_szMessage[i], -1, &rect, 0 );
+                for( int field = 0; field < STATUS_FIELDS; field++ )
+                {
+                    rect.left = STATUS_LEFT;
+                    rect.top = STATUS_TOP + i * STATUS_PAD_HEIGHT + field * g_iLineHeight;
+                    rect.bottom = rect.top + g_iLineHeight;
+                    if( IntersectRect( &clip, &rect, &ps.rcPaint ) )
+                        DrawText( hDC, g_Status[i].szField[field], -1, &rect, DT_SINGLELINE | DT_NOPREFIX );
+                }
             }
 
             EndPaint( hWnd, &ps );
@@ -0,0 +1,19 @@
+//-----------------------------------------------------------------------------
+// File: SimpleController.h
+//
+// Declarations for the Windows front end.  The input and drive threads are
+// platform neutral and do not include this.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "GamepadXInput.h"
+
+
+//-----------------------------------------------------------------------------
+// Defines, constants, and shared structures
+//-----------------------------------------------------------------------------
+#define WM_CONTROLLER_UPDATE ( WM_APP + 1 )        // Posted for the input thread when a new snapshot is ready for display
+
+extern HWND               g_hWnd;         //主控台視窗控制代碼
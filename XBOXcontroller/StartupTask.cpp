@@ -0,0 +1,90 @@
+//-----------------------------------------------------------------------------
+// File: StartupTask.cpp
+//
+// Connecting things in parallel at startup
+//-----------------------------------------------------------------------------
+#include "StartupTask.h"
+#include "HighResClock.h"
+
+
+//-----------------------------------------------------------------------------
+Readiness::Readiness() :
+    mySet( false ),
+    myOk( false )
+{
+    myCondition.setLogName( "Readiness::myCondition" );
+}
+
+
+//-----------------------------------------------------------------------------
+void Readiness::set( bool bOk )
+{
+    myOk.store( bOk );
+    mySet.store( true );
+    myCondition.broadcast();
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: wait()
+// Desc: ArCondition keeps no state, so a broadcast between the test and the
+//       wait would be lost; waiting in short slices bounds what that costs.
+//-----------------------------------------------------------------------------
+bool Readiness::wait( unsigned int timeoutMs )
+{
+    ArTime started;
+    while( !mySet.load() )
+    {
+        long waited = started.mSecSince();
+        if( waited >= (long)timeoutMs )
+            return false;
+        unsigned int slice = timeoutMs - (unsigned int)waited;
+        myCondition.timedWait( slice < STARTUP_WAIT_SLICE_MS ? slice : STARTUP_WAIT_SLICE_MS );
+    }
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+StartupTask::StartupTask( const char *name, ArRetFunctor<bool> *connect, long long startUs ) :
+    myName( name ),
+    myConnect( connect ),
+    myStartUs( startUs ),
+    myStarted( false )
+{
+    setThreadName( name );
+}
+
+
+//-----------------------------------------------------------------------------
+StartupTask::~StartupTask()
+{
+    finish();
+}
+
+
+//-----------------------------------------------------------------------------
+bool StartupTask::finish()
+{
+    if( myStarted )
+    {
+        join();
+        myStarted = false;
+    }
+    return myReady.isOk();
+}
+
+
+//-----------------------------------------------------------------------------
+void *StartupTask::runThread( void * )
+{
+    threadStarted();
+
+    bool bOk = myConnect->invokeR();
+    ArLog::log( bOk ? ArLog::Normal : ArLog::Terse, "Startup: %s %s %lld ms after start",
+                myName, bOk ? "ready" : "failed", ( MonotonicMicros() - myStartUs ) / 1000 );
+    myReady.set( bOk );
+
+    threadFinished();
+    return nullptr;
+}
@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------
+// File: StartupTask.h
+//
+// Connecting things in parallel at startup.  A StartupTask runs one blocking
+// connect on its own thread and reports through a Readiness, which anyone
+// can test or wait on with a timeout.  Only the robot base is on the path to
+// a usable pad; lasers, the compass and extra pad robots come up behind it.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "Aria.h"
+#include <atomic>
+
+#define STARTUP_WAIT_SLICE_MS 20    // longest a missed signal can delay a waiter
+
+// Set once, from any thread
+class Readiness
+{
+public:
+    Readiness();
+
+    void set( bool bOk );
+    bool isSet() const { return mySet.load(); }
+    bool isOk() const { return myOk.load(); }
+
+    // True once set; false if timeoutMs passed first
+    bool wait( unsigned int timeoutMs );
+
+protected:
+    std::atomic<bool> mySet;
+    std::atomic<bool> myOk;
+    ArCondition myCondition;
+};
+
+class StartupTask : public ArASyncTask
+{
+public:
+    // connect is invoked on the task's thread and must outlive it.  The time
+    // it took is logged against startUs (MonotonicMicros()).
+    StartupTask( const char *name, ArRetFunctor<bool> *connect, long long startUs );
+    // Waits for the connect to finish
+    virtual ~StartupTask();
+
+    virtual void *runThread( void *arg );
+    // At normal priority; startup is what everything else is waiting for
+    void start() { myStarted = true; create( true, false ); }
+    // Wait for the connect to finish; true if it succeeded
+    bool finish();
+
+    Readiness *getReady() { return &myReady; }
+    const char *getName() const { return myName; }
+
+protected:
+    const char *myName;
+    ArRetFunctor<bool> *myConnect;
+    long long myStartUs;
+    bool myStarted;
+    Readiness myReady;
+};
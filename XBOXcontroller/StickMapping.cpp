@@ -0,0 +1,53 @@
+//-----------------------------------------------------------------------------
+// File: StickMapping.cpp
+//
+// Continuous thumbstick-to-velocity mapping
+//-----------------------------------------------------------------------------
+#include "StickMapping.h"
+
+
+//-----------------------------------------------------------------------------
+StickMapper::StickMapper() :
+    myMode( STICK_ARCADE ),
+    myMaxTransVel( STICK_MAX_TRANS_VEL ),
+    myMaxRotVel( STICK_MAX_ROT_VEL )
+{
+}
+
+
+//-----------------------------------------------------------------------------
+void StickMapper::setLimits( double maxTransVel, double maxRotVel )
+{
+    myMaxTransVel = maxTransVel;
+    myMaxRotVel = maxRotVel;
+}
+
+
+//-----------------------------------------------------------------------------
+void StickMapper::mapArcade( float x, float y, double *transVel, double *rotVel ) const
+{
+    *transVel = y * myMaxTransVel;
+    // Stick right means clockwise, which is negative rotation in ARIA
+    *rotVel = -x * myMaxRotVel;
+}
+
+
+//-----------------------------------------------------------------------------
+void StickMapper::mapTank( float x, float y, double *leftVel, double *rightVel ) const
+{
+    float left = y + x;
+    float right = y - x;
+
+    // Keep the ratio between the wheels when one of them would saturate
+    float biggest = left < 0 ? -left : left;
+    float other = right < 0 ? -right : right;
+    if( other > biggest ) biggest = other;
+    if( biggest > 1 )
+    {
+        left /= biggest;
+        right /= biggest;
+    }
+
+    *leftVel = left * myMaxTransVel;
+    *rightVel = right * myMaxTransVel;
+}
@@ -0,0 +1,39 @@
+//-----------------------------------------------------------------------------
+// File: StickMapping.h
+//
+// Continuous thumbstick-to-velocity mapping.  The stick arrives already
+// shaped by the dead zone kernel (dead zone, rescaling and response curve
+// applied), so mapping it is a couple of multiplies, with no branches on the
+// stick angle and no trig.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#define STICK_MAX_TRANS_VEL 250.0   // mm/s at full forward/backward deflection
+#define STICK_MAX_ROT_VEL    50.0   // deg/s at full left/right deflection
+
+enum STICK_MODE
+{
+    STICK_ARCADE,   // Y is translation, X is rotation (setVel + setRotVel)
+    STICK_TANK      // Y +/- X mixed into left/right wheel speeds (setVel2)
+};
+
+class StickMapper
+{
+public:
+    StickMapper();
+
+    void setLimits( double maxTransVel, double maxRotVel );
+    void setMode( STICK_MODE mode ) { myMode = mode; }
+    STICK_MODE getMode() const { return myMode; }
+
+    // x and y are shaped stick values in [-1, 1]
+    // STICK_ARCADE: translation (mm/s, + forward) and rotation (deg/s, + left)
+    void mapArcade( float x, float y, double *transVel, double *rotVel ) const;
+    // STICK_TANK: left and right wheel speeds in mm/s
+    void mapTank( float x, float y, double *leftVel, double *rightVel ) const;
+
+protected:
+    STICK_MODE myMode;
+    double myMaxTransVel;
+    double myMaxRotVel;
+};
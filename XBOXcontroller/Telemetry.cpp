@@ -0,0 +1,56 @@
+//-----------------------------------------------------------------------------
+// File: Telemetry.cpp
+//
+// Lock-free telemetry ring
+//-----------------------------------------------------------------------------
+#include "Telemetry.h"
+
+
+//-----------------------------------------------------------------------------
+TelemetryRing::TelemetryRing() :
+    myHead( 0 )
+{
+    for( int i = 0; i < TELEMETRY_SAMPLES; i++ )
+        myEntries[i].uSequence.store( 0 );
+}
+
+
+//-----------------------------------------------------------------------------
+void TelemetryRing::push( const TELEMETRY_SAMPLE &sample )
+{
+    unsigned int n = myHead.load( std::memory_order_relaxed );
+    ENTRY &entry = myEntries[n % TELEMETRY_SAMPLES];
+    entry.uSequence.store( 2 * n + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    entry.sample = sample;
+    entry.uSequence.store( 2 * n + 2, std::memory_order_release );
+    myHead.store( n + 1, std::memory_order_release );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: copyLatest()
+// Desc: Entries overwritten while we copy them are skipped
+//-----------------------------------------------------------------------------
+int TelemetryRing::copyLatest( TELEMETRY_SAMPLE *out, int max ) const
+{
+    unsigned int head = myHead.load( std::memory_order_acquire );
+    unsigned int count = head < (unsigned int)max ? head : (unsigned int)max;
+    if( count > TELEMETRY_SAMPLES )
+        count = TELEMETRY_SAMPLES;
+
+    int copied = 0;
+    for( unsigned int n = head - count; n != head; n++ )
+    {
+        const ENTRY &entry = myEntries[n % TELEMETRY_SAMPLES];
+        unsigned int sequence = entry.uSequence.load( std::memory_order_acquire );
+        if( sequence != 2 * n + 2 )
+            continue;
+        out[copied] = entry.sample;
+        std::atomic_thread_fence( std::memory_order_acquire );
+        if( entry.uSequence.load( std::memory_order_relaxed ) != sequence )
+            continue;
+        copied++;
+    }
+    return copied;
+}
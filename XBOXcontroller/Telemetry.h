@@ -0,0 +1,49 @@
+//-----------------------------------------------------------------------------
+// File: Telemetry.h
+//
+// Fixed ring of status samples.  One thread pushes; any thread may copy the
+// newest samples out without locking.  Each entry carries a sequence number
+// that is odd while it is being written, so a reader that raced the writer
+// drops that entry instead of returning a torn one.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include <atomic>
+
+#define TELEMETRY_SAMPLES 256    // about 25 s at TELEMETRY_PERIOD_MS
+#define TELEMETRY_PERIOD_MS 100
+
+struct TELEMETRY_SAMPLE
+{
+    long long      llTimeUs;         // MonotonicMicros()
+    unsigned int   uPadsConnected;   // bit per controller slot
+    int            iOwner;           // pad driving the main robot, -1 for none
+    float          fX, fY, fTh;      // main robot pose, mm and deg
+    float          fVel, fRotVel;    // mm/s, deg/s
+    float          fBattery;         // volts
+    unsigned int   uInputSamples;
+    unsigned int   uLatencyP99Us;    // main robot input->send
+};
+
+class TelemetryRing
+{
+public:
+    TelemetryRing();
+
+    // Writer only
+    void push( const TELEMETRY_SAMPLE &sample );
+
+    // Copies up to max of the newest samples, oldest first; returns how many
+    int copyLatest( TELEMETRY_SAMPLE *out, int max ) const;
+    unsigned int getPushed() const { return myHead.load(); }
+
+protected:
+    struct ENTRY
+    {
+        std::atomic<unsigned int> uSequence;
+        TELEMETRY_SAMPLE sample;
+    };
+
+    ENTRY myEntries[TELEMETRY_SAMPLES];
+    std::atomic<unsigned int> myHead;     // samples pushed so far
+};
@@ -0,0 +1,236 @@
+//-----------------------------------------------------------------------------
+// File: DeadzoneBench.cpp
+//
+// Microbenchmark for the dead zone step of the input thread: the original
+// per-axis square test, the scalar kernel and the SSE2 kernel, all run over
+// the same recorded-looking stream of four-pad states.  The SSE2 kernel is
+// first checked against the scalar one on every frame and curve, and the
+// bench fails if they differ by more than MAX_KERNEL_DIFF.
+//
+// Build (from XBOXcontroller\bench):
+//   cl /O2 /EHsc /I.. DeadzoneBench.cpp ..\DeadzoneKernel.cpp
+//   g++ -O2 -I.. DeadzoneBench.cpp ../DeadzoneKernel.cpp -o DeadzoneBench
+//-----------------------------------------------------------------------------
+#include "DeadzoneKernel.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+static double NowSeconds()
+{
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter( &counter );
+    QueryPerformanceFrequency( &frequency );
+    return double( counter.QuadPart ) / double( frequency.QuadPart );
+}
+#else
+#include <time.h>
+static double NowSeconds()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+#endif
+
+#define FRAMES      4096
+#define ITERATIONS  2000
+#define DEADZONE    ( 0.24f * float( 0x7FFF ) )
+#define MAX_KERNEL_DIFF 1e-5f   // shaped values are in [-1, 1]
+
+// Same layout as XINPUT_GAMEPAD, so the legacy path touches the same bytes
+struct GAMEPAD
+{
+    unsigned short wButtons;
+    unsigned char bLeftTrigger;
+    unsigned char bRightTrigger;
+    short sThumbLX;
+    short sThumbLY;
+    short sThumbRX;
+    short sThumbRY;
+};
+
+static GAMEPAD g_Frames[FRAMES][AXES_LANES];
+
+
+//-----------------------------------------------------------------------------
+// Name: LegacyDeadzone()
+// Desc: The square dead zone RenderFrame used to run per pad
+//-----------------------------------------------------------------------------
+static void LegacyDeadzone( GAMEPAD *pads )
+{
+    for( int i = 0; i < AXES_LANES; i++ )
+    {
+        GAMEPAD &g = pads[i];
+        if( ( g.sThumbLX < DEADZONE && g.sThumbLX > -DEADZONE ) &&
+            ( g.sThumbLY < DEADZONE && g.sThumbLY > -DEADZONE ) )
+        {
+            g.sThumbLX = 0;
+            g.sThumbLY = 0;
+        }
+        if( ( g.sThumbRX < DEADZONE && g.sThumbRX > -DEADZONE ) &&
+            ( g.sThumbRY < DEADZONE && g.sThumbRY > -DEADZONE ) )
+        {
+            g.sThumbRX = 0;
+            g.sThumbRY = 0;
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+static void Load( const GAMEPAD *pads, CONTROLLER_AXES *axes )
+{
+    for( int i = 0; i < AXES_LANES; i++ )
+    {
+        axes->fThumbLX[i] = pads[i].sThumbLX;
+        axes->fThumbLY[i] = pads[i].sThumbLY;
+        axes->fThumbRX[i] = pads[i].sThumbRX;
+        axes->fThumbRY[i] = pads[i].sThumbRY;
+        axes->fLeftTrigger[i] = pads[i].bLeftTrigger;
+        axes->fRightTrigger[i] = pads[i].bRightTrigger;
+    }
+}
+
+
+#ifdef DEADZONE_KERNEL_SSE2
+//-----------------------------------------------------------------------------
+// Name: CompareKernels()
+// Desc: Largest difference between the SSE2 and scalar kernels over every
+//       frame and output
+//-----------------------------------------------------------------------------
+static float CompareKernels( const AXIS_SHAPING &shaping )
+{
+    float maxDiff = 0;
+    for( int f = 0; f < FRAMES; f++ )
+    {
+        CONTROLLER_AXES scalar, sse2;
+        Load( g_Frames[f], &scalar );
+        Load( g_Frames[f], &sse2 );
+        ShapeControllerAxesScalar( &scalar, shaping );
+        ShapeControllerAxesSSE2( &sse2, shaping );
+
+        const float *a = &scalar.fThumbLX[0];
+        const float *b = &sse2.fThumbLX[0];
+        for( int i = 0; i < int( sizeof( CONTROLLER_AXES ) / sizeof( float ) ); i++ )
+        {
+            float diff = fabsf( a[i] - b[i] );
+            if( !( diff <= maxDiff ) )
+                maxDiff = diff;     // a NaN sticks
+        }
+    }
+    return maxDiff;
+}
+#endif
+
+
+//-----------------------------------------------------------------------------
+static short RandomAxis()
+{
+    // Mostly small values around center with occasional full deflection,
+    // roughly what idle pads and active driving look like
+    int r = rand() % 100;
+    int v = r < 60 ? rand() % 6000 : ( r < 90 ? rand() % 32768 : 32767 );
+    return short( ( rand() & 1 ) ? v : -v );
+}
+
+
+//-----------------------------------------------------------------------------
+int main()
+{
+    srand( 1 );
+    for( int f = 0; f < FRAMES; f++ )
+    {
+        for( int i = 0; i < AXES_LANES; i++ )
+        {
+            GAMEPAD &g = g_Frames[f][i];
+            g.wButtons = 0;
+            g.bLeftTrigger = (unsigned char)( rand() % 256 );
+            g.bRightTrigger = (unsigned char)( rand() % 256 );
+            g.sThumbLX = RandomAxis();
+            g.sThumbLY = RandomAxis();
+            g.sThumbRX = RandomAxis();
+            g.sThumbRY = RandomAxis();
+        }
+    }
+
+    AXIS_SHAPING shaping;
+    shaping.fStickDeadZone = DEADZONE;
+    shaping.fTriggerThreshold = 30;
+    shaping.eCurve = CURVE_EXPO;
+
+    int failures = 0;
+#ifdef DEADZONE_KERNEL_SSE2
+    static const RESPONSE_CURVE curves[] = { CURVE_LINEAR, CURVE_EXPO, CURVE_CUBIC };
+    static const char *curveNames[] = { "linear", "expo", "cubic" };
+    for( int c = 0; c < 3; c++ )
+    {
+        AXIS_SHAPING check = shaping;
+        check.eCurve = curves[c];
+        float maxDiff = CompareKernels( check );
+        bool bFailed = !( maxDiff <= MAX_KERNEL_DIFF );
+        printf( "SSE2 vs scalar, %-6s: max difference %g%s\n", curveNames[c], maxDiff, bFailed ? "  MISMATCH" : "" );
+        failures += bFailed;
+    }
+#endif
+
+    double checksum = 0;
+    double start, legacy, scalar, sse2 = 0;
+
+    start = NowSeconds();
+    for( int it = 0; it < ITERATIONS; it++ )
+    {
+        for( int f = 0; f < FRAMES; f++ )
+        {
+            GAMEPAD pads[AXES_LANES];
+            for( int i = 0; i < AXES_LANES; i++ )
+                pads[i] = g_Frames[f][i];
+            LegacyDeadzone( pads );
+            checksum += pads[it & 3].sThumbLX;
+        }
+    }
+    legacy = NowSeconds() - start;
+
+    start = NowSeconds();
+    for( int it = 0; it < ITERATIONS; it++ )
+    {
+        for( int f = 0; f < FRAMES; f++ )
+        {
+            CONTROLLER_AXES axes;
+            Load( g_Frames[f], &axes );
+            ShapeControllerAxesScalar( &axes, shaping );
+            checksum += axes.fThumbLX[it & 3];
+        }
+    }
+    scalar = NowSeconds() - start;
+
+#ifdef DEADZONE_KERNEL_SSE2
+    start = NowSeconds();
+    for( int it = 0; it < ITERATIONS; it++ )
+    {
+        for( int f = 0; f < FRAMES; f++ )
+        {
+            CONTROLLER_AXES axes;
+            Load( g_Frames[f], &axes );
+            ShapeControllerAxesSSE2( &axes, shaping );
+            checksum += axes.fThumbLX[it & 3];
+        }
+    }
+    sse2 = NowSeconds() - start;
+#endif
+
+    double frames = double( FRAMES ) * ITERATIONS;
+    printf( "four-pad frames: %.0f\n", frames );
+    printf( "legacy square dead zone      : %6.2f ns/frame (dead zone only)\n", legacy * 1e9 / frames );
+    printf( "scalar radial+rescale+curve  : %6.2f ns/frame\n", scalar * 1e9 / frames );
+#ifdef DEADZONE_KERNEL_SSE2
+    printf( "SSE2 radial+rescale+curve    : %6.2f ns/frame\n", sse2 * 1e9 / frames );
+#else
+    printf( "SSE2 kernel not available in this build\n" );
+#endif
+    printf( "(checksum %g, %d mismatches)\n", checksum, failures );
+    return failures != 0;
+}
@@ -0,0 +1,345 @@
+//-----------------------------------------------------------------------------
+// File: PacketBench.cpp
+//
+// Frames and checks a byte stream the way the serial readers do: find the
+// next sync pair, take the length, verify the checksum, move on.  Runs the
+// byte-at-a-time code that matches ARIA's against the PacketChecksum
+// routines, over the same stream, and checks they find the same packets.
+//
+// The argument is a -recordPackets file; its packets are laid end to end
+// with a few bytes of line noise between some of them.  Without one, a
+// stream of synthetic SIPs is used.  LMS2xx frames are always synthetic,
+// a full 361-reading scan each.
+//
+// Build (from XBOXcontroller\bench):
+//   cl /O2 /EHsc PacketBench.cpp PacketChecksum.cpp
+//   g++ -O2 PacketBench.cpp PacketChecksum.cpp -o PacketBench
+//-----------------------------------------------------------------------------
+#include "PacketChecksum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+static double NowSeconds()
+{
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter( &counter );
+    QueryPerformanceFrequency( &frequency );
+    return double( counter.QuadPart ) / double( frequency.QuadPart );
+}
+#else
+#include <time.h>
+static double NowSeconds()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+#endif
+
+#define PASSES          50
+#define SYNTH_SIPS      20000
+#define SYNTH_SCANS     2000
+#define SCAN_READINGS   361
+#define NOISE_EVERY     16     // packets between bursts of line noise
+
+
+//-----------------------------------------------------------------------------
+// Name: AddNoise()
+// Desc: A few random bytes, as after a dropped byte or a reconnect
+//-----------------------------------------------------------------------------
+static void AddNoise( std::vector<unsigned char> *stream )
+{
+    int count = 1 + rand() % 8;
+    for( int i = 0; i < count; i++ )
+        stream->push_back( (unsigned char)rand() );
+}
+
+
+//-----------------------------------------------------------------------------
+static void AddRobotPacket( std::vector<unsigned char> *stream, const unsigned char *body, int length )
+{
+    stream->push_back( ROBOT_SYNC_1 );
+    stream->push_back( ROBOT_SYNC_2 );
+    stream->push_back( (unsigned char)( length + 2 ) );
+    stream->insert( stream->end(), body, body + length );
+    unsigned short sum = RobotChecksumScalar( body, length );
+    stream->push_back( (unsigned char)( sum >> 8 ) );
+    stream->push_back( (unsigned char)( sum & 0xFF ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: ReadRecorded()
+// Desc: The packets of a -recordPackets file, laid end to end
+//-----------------------------------------------------------------------------
+static bool ReadRecorded( const char *path, std::vector<unsigned char> *stream )
+{
+    FILE *file = fopen( path, "rb" );
+    if( file == nullptr )
+        return false;
+    long long llTimeUs;
+    unsigned short wLength;
+    unsigned char packet[65536];
+    unsigned int n = 0;
+    while( fread( &llTimeUs, sizeof( llTimeUs ), 1, file ) == 1 &&
+           fread( &wLength, sizeof( wLength ), 1, file ) == 1 &&
+           fread( packet, 1, wLength, file ) == wLength )
+    {
+        stream->insert( stream->end(), packet, packet + wLength );
+        if( ++n % NOISE_EVERY == 0 )
+            AddNoise( stream );
+    }
+    fclose( file );
+    return n > 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: WriteSyntheticSips()
+// Desc: Standard SIPs: position, heading, velocities, sonar readings, a
+//       random length each like a robot with some sonar not in range
+//-----------------------------------------------------------------------------
+static void WriteSyntheticSips( std::vector<unsigned char> *stream )
+{
+    unsigned char body[256];
+    for( int n = 0; n < SYNTH_SIPS; n++ )
+    {
+        int length = 30 + rand() % 60;
+        body[0] = 0x32;
+        for( int i = 1; i < length; i++ )
+            body[i] = (unsigned char)rand();
+        AddRobotPacket( stream, body, length );
+        if( ( n + 1 ) % NOISE_EVERY == 0 )
+            AddNoise( stream );
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: WriteSyntheticScans()
+// Desc: LMS2xx range scans: STX, address, length, 0xB0, the reading count,
+//       the readings, status, CRC
+//-----------------------------------------------------------------------------
+static void WriteSyntheticScans( std::vector<unsigned char> *stream )
+{
+    for( int n = 0; n < SYNTH_SCANS; n++ )
+    {
+        size_t start = stream->size();
+        int length = 1 + 2 + SCAN_READINGS * 2 + 1;
+        stream->push_back( LMS_STX );
+        stream->push_back( LMS_ADDRESS_HOST );
+        stream->push_back( (unsigned char)( length & 0xFF ) );
+        stream->push_back( (unsigned char)( length >> 8 ) );
+        stream->push_back( 0xB0 );
+        stream->push_back( (unsigned char)( SCAN_READINGS & 0xFF ) );
+        stream->push_back( (unsigned char)( SCAN_READINGS >> 8 ) );
+        for( int i = 0; i < SCAN_READINGS; i++ )
+        {
+            int range = 500 + rand() % 7500;
+            stream->push_back( (unsigned char)( range & 0xFF ) );
+            stream->push_back( (unsigned char)( range >> 8 ) );
+        }
+        stream->push_back( 0x10 );
+        unsigned short crc = LmsCrcScalar( &( *stream )[start], int( stream->size() - start ) );
+        stream->push_back( (unsigned char)( crc & 0xFF ) );
+        stream->push_back( (unsigned char)( crc >> 8 ) );
+        if( ( n + 1 ) % NOISE_EVERY == 0 )
+            AddNoise( stream );
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: ArRobotChecksum() / ArLmsCrc()
+// Desc: As ArRobotPacket::calcCheckSum and ArLMS2xxPacket::calcCRC do it
+//-----------------------------------------------------------------------------
+static unsigned short ArRobotChecksum( const unsigned char *data, int length )
+{
+    int c = 0;
+    int i = 0;
+    int n = length;
+    while( n > 1 )
+    {
+        c += ( data[i] << 8 ) | data[i + 1];
+        c = c & 0xFFFF;
+        n -= 2;
+        i += 2;
+    }
+    if( n > 0 )
+        c = c ^ data[i];
+    return (unsigned short)c;
+}
+
+static unsigned short ArLmsCrc( const unsigned char *data, int length )
+{
+    unsigned short crc = 0;
+    unsigned char abData[2] = { 0, 0 };
+    while( length-- )
+    {
+        abData[1] = abData[0];
+        abData[0] = *data++;
+        if( crc & 0x8000 )
+        {
+            crc = ( crc & 0x7FFF ) << 1;
+            crc ^= LMS_CRC_POLY;
+        }
+        else
+        {
+            crc <<= 1;
+        }
+        crc ^= (unsigned short)( abData[0] | ( abData[1] << 8 ) );
+    }
+    return crc;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: FrameRobot()
+// Desc: Count the good packets in the stream.  A bad checksum resyncs one
+//       byte on, like ArRobotPacketReceiver.
+//-----------------------------------------------------------------------------
+typedef int (*FIND_FN)( const unsigned char *, int, unsigned char, unsigned char );
+typedef unsigned short (*CHECKSUM_FN)( const unsigned char *, int );
+
+static int FrameRobot( const unsigned char *data, int size, FIND_FN find, CHECKSUM_FN checksum )
+{
+    int good = 0;
+    int at = 0;
+    for( ;; )
+    {
+        int found = find( data + at, size - at, ROBOT_SYNC_1, ROBOT_SYNC_2 );
+        if( found < 0 )
+            return good;
+        at += found;
+        if( at + ROBOT_HEADER > size )
+            return good;
+        int packetSize = ROBOT_HEADER + data[at + 2];
+        if( at + packetSize > size )
+            return good;
+        unsigned short sum = checksum( data + at + ROBOT_HEADER, packetSize - ROBOT_HEADER - 2 );
+        if( data[at + packetSize - 2] == ( sum >> 8 ) && data[at + packetSize - 1] == ( sum & 0xFF ) )
+        {
+            good++;
+            at += packetSize;
+        }
+        else
+        {
+            at++;
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+static int FrameLms( const unsigned char *data, int size, FIND_FN find, CHECKSUM_FN crcFn )
+{
+    int good = 0;
+    int at = 0;
+    for( ;; )
+    {
+        int found = find( data + at, size - at, LMS_STX, LMS_ADDRESS_HOST );
+        if( found < 0 )
+            return good;
+        at += found;
+        if( at + LMS_HEADER > size )
+            return good;
+        int packetSize = LMS_HEADER + ( data[at + 2] | ( data[at + 3] << 8 ) ) + 2;
+        if( at + packetSize > size )
+        {
+            at++;
+            continue;
+        }
+        unsigned short crc = crcFn( data + at, packetSize - 2 );
+        if( data[at + packetSize - 2] == ( crc & 0xFF ) && data[at + packetSize - 1] == ( crc >> 8 ) )
+        {
+            good++;
+            at += packetSize;
+        }
+        else
+        {
+            at++;
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+static double TimeRobot( const std::vector<unsigned char> &stream, FIND_FN find, CHECKSUM_FN checksum, int *good )
+{
+    double start = NowSeconds();
+    for( int pass = 0; pass < PASSES; pass++ )
+        *good = FrameRobot( &stream[0], int( stream.size() ), find, checksum );
+    return ( NowSeconds() - start ) * 1e9 / ( double( stream.size() ) * PASSES );
+}
+
+
+//-----------------------------------------------------------------------------
+static double TimeLms( const std::vector<unsigned char> &stream, FIND_FN find, CHECKSUM_FN crcFn, int *good )
+{
+    double start = NowSeconds();
+    for( int pass = 0; pass < PASSES; pass++ )
+        *good = FrameLms( &stream[0], int( stream.size() ), find, crcFn );
+    return ( NowSeconds() - start ) * 1e9 / ( double( stream.size() ) * PASSES );
+}
+
+
+//-----------------------------------------------------------------------------
+int main( int argc, char **argv )
+{
+    srand( 1 );
+    std::vector<unsigned char> robot;
+    if( argc > 1 )
+    {
+        if( !ReadRecorded( argv[1], &robot ) )
+        {
+            printf( "could not read %s as a packet recording\n", argv[1] );
+            return 1;
+        }
+    }
+    else
+    {
+        WriteSyntheticSips( &robot );
+    }
+    std::vector<unsigned char> lms;
+    WriteSyntheticScans( &lms );
+
+    printf( "robot stream: %u bytes from %s\n", (unsigned int)robot.size(), argc > 1 ? argv[1] : "synthetic SIPs" );
+    printf( "lms stream:   %u bytes, %d scans\n", (unsigned int)lms.size(), SYNTH_SCANS );
+
+    int goodRef, good;
+    double nsRef = TimeRobot( robot, FindSyncPairScalar, ArRobotChecksum, &goodRef );
+    printf( "robot  byte loop:      %6.3f ns/byte  %d packets\n", nsRef, goodRef );
+    double ns = TimeRobot( robot, FindSyncPair, RobotChecksum, &good );
+    printf( "robot  PacketChecksum: %6.3f ns/byte  %d packets%s\n", ns, good, good == goodRef ? "" : "  MISMATCH" );
+    int mismatches = good != goodRef;
+
+    nsRef = TimeLms( lms, FindSyncPairScalar, ArLmsCrc, &goodRef );
+    printf( "lms    byte loop:      %6.3f ns/byte  %d scans\n", nsRef, goodRef );
+    ns = TimeLms( lms, FindSyncPair, LmsCrcScalar, &good );
+    printf( "lms    branchless:     %6.3f ns/byte  %d scans%s\n", ns, good, good == goodRef ? "" : "  MISMATCH" );
+    mismatches += good != goodRef;
+    ns = TimeLms( lms, FindSyncPair, LmsCrcTable, &good );
+    printf( "lms    table:          %6.3f ns/byte  %d scans%s\n", ns, good, good == goodRef ? "" : "  MISMATCH" );
+    mismatches += good != goodRef;
+
+    // Every routine against its reference on every prefix of a scan, to
+    // catch the tails the framed runs never hit
+    const unsigned char *scan = &lms[0];
+    int scanSize = LMS_HEADER + ( scan[2] | ( scan[3] << 8 ) );
+    unsigned int checksum = 0;
+    for( int length = 0; length <= scanSize; length++ )
+    {
+        unsigned short crc = ArLmsCrc( scan, length );
+        unsigned short sum = ArRobotChecksum( scan, length );
+        mismatches += LmsCrcScalar( scan, length ) != crc || LmsCrcTable( scan, length ) != crc ||
+                      RobotChecksumScalar( scan, length ) != sum || RobotChecksum( scan, length ) != sum;
+        checksum = checksum * 31 + crc + sum;
+    }
+    printf( "(checksum %08x, %d mismatches)\n", checksum, mismatches );
+    return mismatches != 0;
+}
@@ -0,0 +1,234 @@
+//-----------------------------------------------------------------------------
+// File: PacketChecksum.cpp
+//
+// Checksums and frame finding for robot and LMS2xx packets
+//-----------------------------------------------------------------------------
+#include "PacketChecksum.h"
+
+#ifdef PACKET_CHECKSUM_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+
+//-----------------------------------------------------------------------------
+unsigned short RobotChecksumScalar( const unsigned char *data, int length )
+{
+    unsigned int sum = 0;
+    int i = 0;
+    for( ; i + 1 < length; i += 2 )
+        sum += ( data[i] << 8 ) | data[i + 1];
+    sum &= 0xFFFF;
+    if( i < length )
+        sum ^= data[i];
+    return (unsigned short)sum;
+}
+
+
+#ifdef PACKET_CHECKSUM_SSE2
+//-----------------------------------------------------------------------------
+// Name: RobotChecksumSSE2()
+// Desc: Eight byte pairs per step.  Swapping the bytes of each 16-bit lane
+//       makes them the big-endian pairs, and the lanes add modulo 2^16 just
+//       like the scalar sum.
+//-----------------------------------------------------------------------------
+unsigned short RobotChecksumSSE2( const unsigned char *data, int length )
+{
+    __m128i acc = _mm_setzero_si128();
+    int i = 0;
+    for( ; i + 16 <= length; i += 16 )
+    {
+        __m128i v = _mm_loadu_si128( (const __m128i *)( data + i ) );
+        acc = _mm_add_epi16( acc, _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) ) );
+    }
+
+    unsigned short lanes[8];
+    _mm_storeu_si128( (__m128i *)lanes, acc );
+    unsigned int sum = 0;
+    for( int lane = 0; lane < 8; lane++ )
+        sum += lanes[lane];
+
+    for( ; i + 1 < length; i += 2 )
+        sum += ( data[i] << 8 ) | data[i + 1];
+    sum &= 0xFFFF;
+    if( i < length )
+        sum ^= data[i];
+    return (unsigned short)sum;
+}
+#endif
+
+
+//-----------------------------------------------------------------------------
+unsigned short RobotChecksum( const unsigned char *data, int length )
+{
+#ifdef PACKET_CHECKSUM_SSE2
+    return RobotChecksumSSE2( data, length );
+#else
+    return RobotChecksumScalar( data, length );
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+bool VerifyRobotPacket( const unsigned char *packet, int size )
+{
+    if( size < ROBOT_HEADER + 3 || packet[0] != ROBOT_SYNC_1 || packet[1] != ROBOT_SYNC_2 ||
+        packet[2] + ROBOT_HEADER != size )
+        return false;
+    unsigned short sum = RobotChecksum( packet + ROBOT_HEADER, size - ROBOT_HEADER - 2 );
+    return packet[size - 2] == ( sum >> 8 ) && packet[size - 1] == ( sum & 0xFF );
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: LmsCrcScalar()
+// Desc: Every byte shifts the register once and XORs in the last two bytes
+//       as a word.  Written without the branch on the top bit, which a
+//       random stream mispredicts half the time.
+//-----------------------------------------------------------------------------
+unsigned short LmsCrcScalar( const unsigned char *data, int length )
+{
+    unsigned int crc = 0;
+    unsigned int previous = 0;
+    for( int i = 0; i < length; i++ )
+    {
+        unsigned int poly = ( 0u - ( crc >> 15 ) ) & LMS_CRC_POLY;
+        crc = ( ( crc << 1 ) & 0xFFFF ) ^ poly ^ ( data[i] | ( previous << 8 ) );
+        previous = data[i];
+    }
+    return (unsigned short)crc;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: LmsCrcTable()
+// Desc: The register is the polynomial sum of the words, each times x for
+//       every byte after it, modulo x^16 + LMS_CRC_POLY.  Eight bytes
+//       b0..b7 with p the byte before them then give
+//
+//           crc' = ( ( crc ^ s2 ) * x^8 mod P ) ^ s1
+//
+//       where s1 is b0..b7 and s2 is p..b6, each byte shifted one bit less
+//       than the one before.  s1 stays under 16 bits, and the multiply is a
+//       shift plus one lookup for the byte that falls off the top.
+//-----------------------------------------------------------------------------
+static unsigned short g_LmsReduce[256];   // h * x^16 mod P
+
+// Filled before main, so no thread ever sees it half built
+static struct LmsReduceInit
+{
+    LmsReduceInit()
+    {
+        for( unsigned int h = 0; h < 256; h++ )
+        {
+            unsigned int v = h << 8;
+            for( int bit = 0; bit < 8; bit++ )
+                v = ( ( v << 1 ) & 0xFFFF ) ^ ( ( 0u - ( v >> 15 ) ) & LMS_CRC_POLY );
+            g_LmsReduce[h] = (unsigned short)v;
+        }
+    }
+} g_LmsReduceInit;
+
+unsigned short LmsCrcTable( const unsigned char *data, int length )
+{
+    unsigned int crc = 0;
+    unsigned int previous = 0;
+    int i = 0;
+    for( ; i + 8 <= length; i += 8 )
+    {
+        const unsigned char *b = data + i;
+        unsigned int h = 0;
+        for( int k = 0; k < 7; k++ )
+            h = ( h << 1 ) ^ b[k];
+        unsigned int s2 = h ^ ( previous << 7 );
+        unsigned int s1 = ( h << 1 ) ^ b[7];
+        unsigned int v = crc ^ s2;
+        crc = ( ( v << 8 ) & 0xFFFF ) ^ g_LmsReduce[v >> 8] ^ s1;
+        previous = b[7];
+    }
+    for( ; i < length; i++ )
+    {
+        unsigned int poly = ( 0u - ( crc >> 15 ) ) & LMS_CRC_POLY;
+        crc = ( ( crc << 1 ) & 0xFFFF ) ^ poly ^ ( data[i] | ( previous << 8 ) );
+        previous = data[i];
+    }
+    return (unsigned short)crc;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned short LmsCrc( const unsigned char *data, int length )
+{
+    return LmsCrcTable( data, length );
+}
+
+
+//-----------------------------------------------------------------------------
+bool VerifyLmsPacket( const unsigned char *packet, int size )
+{
+    if( size < LMS_HEADER + 2 || packet[0] != LMS_STX )
+        return false;
+    int length = packet[2] | ( packet[3] << 8 );
+    if( LMS_HEADER + length + 2 != size )
+        return false;
+    unsigned short crc = LmsCrc( packet, size - 2 );
+    return packet[size - 2] == ( crc & 0xFF ) && packet[size - 1] == ( crc >> 8 );
+}
+
+
+//-----------------------------------------------------------------------------
+int FindSyncPairScalar( const unsigned char *data, int length, unsigned char first, unsigned char second )
+{
+    for( int i = 0; i + 1 < length; i++ )
+    {
+        if( data[i] == first && data[i + 1] == second )
+            return i;
+    }
+    return -1;
+}
+
+
+#ifdef PACKET_CHECKSUM_SSE2
+//-----------------------------------------------------------------------------
+// Name: FindSyncPairSSE2()
+// Desc: Sixteen candidate positions per step: compare the block and the
+//       block one byte on, and the first bit set in both masks is the pair
+//-----------------------------------------------------------------------------
+int FindSyncPairSSE2( const unsigned char *data, int length, unsigned char first, unsigned char second )
+{
+    __m128i vFirst = _mm_set1_epi8( (char)first );
+    __m128i vSecond = _mm_set1_epi8( (char)second );
+    int i = 0;
+    for( ; i + 17 <= length; i += 16 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)( data + i ) );
+        __m128i b = _mm_loadu_si128( (const __m128i *)( data + i + 1 ) );
+        int mask = _mm_movemask_epi8( _mm_and_si128( _mm_cmpeq_epi8( a, vFirst ), _mm_cmpeq_epi8( b, vSecond ) ) );
+        if( mask != 0 )
+        {
+#ifdef _MSC_VER
+            unsigned long bit;
+            _BitScanForward( &bit, (unsigned long)mask );
+            return i + (int)bit;
+#else
+            return i + __builtin_ctz( (unsigned int)mask );
+#endif
+        }
+    }
+    int rest = FindSyncPairScalar( data + i, length - i, first, second );
+    return rest < 0 ? -1 : i + rest;
+}
+#endif
+
+
+//-----------------------------------------------------------------------------
+int FindSyncPair( const unsigned char *data, int length, unsigned char first, unsigned char second )
+{
+#ifdef PACKET_CHECKSUM_SSE2
+    return FindSyncPairSSE2( data, length, first, second );
+#else
+    return FindSyncPairScalar( data, length, first, second );
+#endif
+}
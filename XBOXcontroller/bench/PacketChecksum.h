@@ -0,0 +1,56 @@
+//-----------------------------------------------------------------------------
+// File: PacketChecksum.h
+//
+// Checksums and frame finding for the two packet formats on our serial
+// lines, over whole buffers instead of a byte at a time:
+//
+//   Robot (ArRobotPacket):  0xFA 0xFB, length, command, data, checksum.  The
+//   checksum is the 16-bit sum of the big-endian byte pairs after the length
+//   byte, an odd last byte XORed in, stored high byte first.
+//
+//   SICK LMS2xx (ArLMS2xxPacket):  STX 0x02, address, 16-bit length, data,
+//   then SICK's CRC16 over everything before it, stored low byte first.
+//
+// Each routine has a scalar version that is the reference, plus a faster
+// one picked when the build allows.  The robot and laser packets we receive
+// are checked inside the prebuilt ARIA library, so for now only the
+// benchmark uses these; they move into the application with the first
+// reader of our own.
+//-----------------------------------------------------------------------------
+#pragma once
+
+#define ROBOT_SYNC_1     0xFA
+#define ROBOT_SYNC_2     0xFB
+#define ROBOT_HEADER       3     // sync bytes and length
+#define LMS_STX          0x02
+#define LMS_ADDRESS_HOST 0x80    // address byte on packets from the laser
+#define LMS_HEADER         4     // STX, address, 16-bit length
+#define LMS_CRC_POLY     0x8005
+
+// Robot checksum of length bytes starting right after the length byte
+unsigned short RobotChecksum( const unsigned char *data, int length );
+unsigned short RobotChecksumScalar( const unsigned char *data, int length );
+
+// Whole packet, size bytes from the first sync byte: header, length byte
+// and checksum all agree
+bool VerifyRobotPacket( const unsigned char *packet, int size );
+
+// SICK CRC16 of length bytes, the whole packet up to the CRC.  Scalar is
+// the shift-register loop from the LMS2xx manual; table steps eight bytes
+// at a time.
+unsigned short LmsCrc( const unsigned char *data, int length );
+unsigned short LmsCrcScalar( const unsigned char *data, int length );
+unsigned short LmsCrcTable( const unsigned char *data, int length );
+
+// Whole packet, size bytes from STX
+bool VerifyLmsPacket( const unsigned char *packet, int size );
+
+// Offset of the first first,second byte pair in data, or -1
+int FindSyncPair( const unsigned char *data, int length, unsigned char first, unsigned char second );
+int FindSyncPairScalar( const unsigned char *data, int length, unsigned char first, unsigned char second );
+
+#if defined(_M_X64) || defined(_M_AMD64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 ) || defined(__SSE2__)
+#define PACKET_CHECKSUM_SSE2
+unsigned short RobotChecksumSSE2( const unsigned char *data, int length );
+int FindSyncPairSSE2( const unsigned char *data, int length, unsigned char first, unsigned char second );
+#endif
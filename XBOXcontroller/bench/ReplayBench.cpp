@@ -0,0 +1,149 @@
+//-----------------------------------------------------------------------------
+// File: ReplayBench.cpp
+//
+// Replays an input log (-recordInput) through the shaping and stick mapping
+// steps of the input and drive threads as fast as possible, with no pad, no
+// window and no robot.  The output ends with a checksum of every velocity
+// produced, so two builds given the same log can be compared for identical
+// behaviour as well as speed.
+//
+// Without a log argument a synthetic session is written to
+// ReplayBench.xpad first and replayed from there.
+//
+// Build (from XBOXcontroller\bench):
+//   cl /O2 /EHsc /I.. ReplayBench.cpp ..\InputLog.cpp ..\DeadzoneKernel.cpp ..\StickMapping.cpp
+//   g++ -O2 -I.. ReplayBench.cpp ../InputLog.cpp ../DeadzoneKernel.cpp ../StickMapping.cpp -o ReplayBench
+//-----------------------------------------------------------------------------
+#include "InputLog.h"
+#include "DeadzoneKernel.h"
+#include "StickMapping.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+static double NowSeconds()
+{
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter( &counter );
+    QueryPerformanceFrequency( &frequency );
+    return double( counter.QuadPart ) / double( frequency.QuadPart );
+}
+#else
+#include <time.h>
+static double NowSeconds()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+#endif
+
+#define PASSES          20
+#define SYNTH_RECORDS   200000
+#define SYNTH_PATH      "ReplayBench.xpad"
+#define DEADZONE        ( 0.24f * 32767.0f )
+
+
+//-----------------------------------------------------------------------------
+// Name: WriteSynthetic()
+// Desc: Two pads driving for a while: sticks sweep smoothly with the odd
+//       jump, one change every 4 ms like the input thread's sample rate
+//-----------------------------------------------------------------------------
+static bool WriteSynthetic( const char *path )
+{
+    InputLogWriter writer;
+    if( !writer.open( path, AXES_LANES, 0 ) )
+        return false;
+
+    srand( 1 );
+    short lx = 0, ly = 0;
+    for( unsigned int n = 0; n < SYNTH_RECORDS; n++ )
+    {
+        INPUT_LOG_RECORD record;
+        memset( &record, 0, sizeof( record ) );
+        record.llTimeUs = (long long)n * 4000;
+        record.uPacket = n + 1;
+        record.bSlot = (unsigned char)( n & 1 );
+        record.bConnected = 1;
+        lx = short( lx + ( rand() % 2001 ) - 1000 );
+        ly = short( ly + ( rand() % 2001 ) - 1000 );
+        if( rand() % 50 == 0 ) ly = short( ( rand() & 1 ) ? 32767 : -32768 );
+        record.sThumbLX = lx;
+        record.sThumbLY = ly;
+        record.sThumbRX = short( rand() % 8000 - 4000 );
+        record.sThumbRY = short( rand() % 8000 - 4000 );
+        record.bLeftTrigger = (unsigned char)( rand() % 10 == 0 ? 255 : 0 );
+        if( !writer.write( record ) )
+            return false;
+    }
+    writer.close();
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+int main( int argc, char **argv )
+{
+    const char *path = argc > 1 ? argv[1] : SYNTH_PATH;
+    if( argc <= 1 && !WriteSynthetic( path ) )
+    {
+        printf( "could not write %s\n", path );
+        return 1;
+    }
+
+    InputLogReader log;
+    if( !log.open( path ) )
+    {
+        printf( "could not read %s as an input log\n", path );
+        return 1;
+    }
+    const INPUT_LOG_RECORD *records = log.getRecords();
+    unsigned int count = log.getCount();
+
+    AXIS_SHAPING shaping;
+    shaping.fStickDeadZone = DEADZONE;
+    shaping.fTriggerThreshold = 30;
+    shaping.eCurve = CURVE_EXPO;
+    StickMapper mapper;
+
+    double checksum = 0;
+    double start = NowSeconds();
+    for( int pass = 0; pass < PASSES; pass++ )
+    {
+        CONTROLLER_AXES raw;
+        memset( &raw, 0, sizeof( raw ) );
+        for( unsigned int n = 0; n < count; n++ )
+        {
+            const INPUT_LOG_RECORD &r = records[n];
+            if( r.bSlot >= AXES_LANES )
+                continue;
+            int i = r.bSlot;
+            raw.fThumbLX[i] = r.bConnected ? r.sThumbLX : 0;
+            raw.fThumbLY[i] = r.bConnected ? r.sThumbLY : 0;
+            raw.fThumbRX[i] = r.bConnected ? r.sThumbRX : 0;
+            raw.fThumbRY[i] = r.bConnected ? r.sThumbRY : 0;
+            raw.fLeftTrigger[i] = r.bConnected ? r.bLeftTrigger : 0;
+            raw.fRightTrigger[i] = r.bConnected ? r.bRightTrigger : 0;
+
+            // Same work the input thread does per changed sample
+            CONTROLLER_AXES axes = raw;
+            ShapeControllerAxes( &axes, shaping );
+
+            double vel, rotVel;
+            mapper.mapArcade( axes.fThumbLX[i], axes.fThumbLY[i], &vel, &rotVel );
+            checksum += vel + rotVel;
+        }
+    }
+    double elapsed = NowSeconds() - start;
+
+    double samples = double( count ) * PASSES;
+    long long llSpanUs = count > 0 ? records[count - 1].llTimeUs : 0;
+    printf( "%s: %u records, %.1f s of input\n", path, count, llSpanUs * 1e-6 );
+    printf( "shape + map: %6.2f ns/record, %.0fx real time\n",
+            elapsed * 1e9 / samples, elapsed > 0 ? llSpanUs * 1e-6 * PASSES / elapsed : 0.0 );
+    printf( "(checksum %.6f)\n", checksum );
+    return 0;
+}